@@ -0,0 +1,26 @@
+#!/bin/sh
+
+# Замер скорости движков процессора (инструкций в секунду) на программах из tests/
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh и ./src/Processor/mk-processor.sh
+
+ENGINES="switch threaded tos jit"
+WORK_DIR=$( mktemp -d )
+
+run() {
+    name=$1
+    input=$2
+
+    ./assembler -i "./tests/$name.txt" -o "$WORK_DIR/$name.bc" || exit 1
+
+    for engine in $ENGINES; do
+        printf "%-16s %-10s " "$name" "$engine"
+        echo "$input" | ./processor -i "$WORK_DIR/$name.bc" -e "$engine" -s 2>&1 | grep "Stats:" | sed 's/Stats: //'
+    done
+}
+
+run factorial     "12"
+run factorial_ram "12"
+run square-solver "1 -3 2"
+run sum-loop      "30000000"
+
+rm -r "$WORK_DIR"
@@ -0,0 +1,29 @@
+#!/bin/sh
+
+# Время ассемблирования программы с большим числом меток (по умолчанию 100000):
+# каждая метка объявлена и вызвана из цепочки переходов, имена длиннее 32 символов.
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh и ./src/Processor/mk-processor.sh
+
+LABELS_COUNT=${LABELS_COUNT:-100000}
+WORK_DIR=$( mktemp -d )
+
+awk -v n="$LABELS_COUNT" 'BEGIN {
+    print "JMP :generated_label_with_a_rather_long_name_0"
+    for ( i = 0; i < n; i++ ) {
+        print ":generated_label_with_a_rather_long_name_" i
+        print "JMP :generated_label_with_a_rather_long_name_" ( i + 1 )
+    }
+    print ":generated_label_with_a_rather_long_name_" n
+    print "PUSH " n
+    print "OUT"
+    print "HLT"
+}' > "$WORK_DIR/labels.txt"
+
+start=$( date +%s.%N )
+./assembler -i "$WORK_DIR/labels.txt" -o "$WORK_DIR/labels.bin" > /dev/null 2>&1 || { echo "Assembler failed"; rm -r "$WORK_DIR"; exit 1; }
+end=$( date +%s.%N )
+
+printf "labels = %s; lines = %s; assemble = %.3f s \n" "$LABELS_COUNT" "$( wc -l < "$WORK_DIR/labels.txt" )" "$( awk -v s="$start" -v e="$end" 'BEGIN { print e - s }' )"
+./processor -i "$WORK_DIR/labels.bin" -e threaded 2>&1
+
+rm -r "$WORK_DIR"
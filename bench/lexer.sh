@@ -0,0 +1,43 @@
+#!/bin/sh
+
+# Пропускная способность ассемблера (MB/s исходного текста) на синтетической программе:
+# команды всех видов операндов, метки, отступы и комментарии. Размер - BLOCKS блоков по 16 строк.
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh
+
+BLOCKS=${BLOCKS:-200000}
+WORK_DIR=$( mktemp -d )
+
+awk -v n="$BLOCKS" 'BEGIN {
+    for ( i = 0; i < n; i++ ) {
+        print ":block_" i "            ; начало блока " i
+        print "    PUSH " i
+        print "    POP RAX"
+        print "    PUSH RAX           ; краткая форма PUSHR"
+        print "    PUSH -" ( i % 1000 )
+        print "    ADD"
+        print "    POPM [RBX]"
+        print "    PUSHM 7"
+        print "    PUSHR RCX"
+        print "    MUL"
+        print "    POPR RDX"
+        print ""
+        print "    PUSH 1"
+        print "    PUSH 2"
+        print "    JB :block_" ( i + 1 )
+        print "    CALL :block_" ( i + 1 )
+    }
+    print ":block_" n
+    print "HLT"
+}' > "$WORK_DIR/big.txt"
+
+bytes=$( wc -c < "$WORK_DIR/big.txt" )
+
+start=$( date +%s.%N )
+./assembler -i "$WORK_DIR/big.txt" -o "$WORK_DIR/big.bin" > /dev/null 2>&1 || { echo "Assembler failed"; rm -r "$WORK_DIR"; exit 1; }
+end=$( date +%s.%N )
+
+awk -v s="$start" -v e="$end" -v b="$bytes" 'BEGIN {
+    printf "source = %.1f MB; assemble = %.3f s; throughput = %.1f MB/s \n", b / 1e6, e - s, b / 1e6 / ( e - s )
+}'
+
+rm -r "$WORK_DIR"
@@ -0,0 +1,27 @@
+#!/bin/sh
+
+# Время загрузки большой программы: текстовый формат прежним циклом sscanf (-T),
+# текстовый формат однопроходным разбором и двоичный формат.
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh и ./src/Processor/mk-processor.sh
+
+PROGRAM_LINES=${PROGRAM_LINES:-400000}
+WORK_DIR=$( mktemp -d )
+
+awk -v n="$PROGRAM_LINES" 'BEGIN { for ( i = 0; i < n; i++ ) print ( i % 2 ) ? "POP" : "PUSH " i; print "HLT" }' > "$WORK_DIR/big.txt"
+
+./assembler -i "$WORK_DIR/big.txt" -o "$WORK_DIR/big.bin"              || exit 1
+./assembler -i "$WORK_DIR/big.txt" -o "$WORK_DIR/big.code" -f text     || exit 1
+
+run() {
+    title=$1
+    shift
+
+    printf "%-14s " "$title"
+    ./processor "$@" -s 2>&1 | grep "Stats: load" | sed 's/Stats: //'
+}
+
+run "text, sscanf" -i "$WORK_DIR/big.code" -T
+run "text"         -i "$WORK_DIR/big.code"
+run "binary"       -i "$WORK_DIR/big.bin"
+
+rm -r "$WORK_DIR"
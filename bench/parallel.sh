@@ -0,0 +1,44 @@
+#!/bin/sh
+
+# Параллельное ассемблирование: время последовательного ассемблера и -j THREADS на синтетической
+# программе из BLOCKS блоков (ссылки вперед и назад через границы частей); байт-код должен совпасть.
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh
+
+BLOCKS=${BLOCKS:-400000}
+THREADS=${THREADS:-$( nproc 2> /dev/null || echo 4 )}
+WORK_DIR=$( mktemp -d )
+
+awk -v n="$BLOCKS" 'BEGIN {
+    for ( i = 0; i < n; i++ ) {
+        print ":block_" i "            ; начало блока " i
+        print "    PUSH " i
+        print "    POP RAX"
+        print "    PUSHM [RBX]"
+        print "    ADD"
+        print "    POPM 7"
+        print "    JB :block_" ( ( i * 7919 ) % n )
+        print "    CALL :block_" ( i + 1 )
+    }
+    print ":block_" n
+    print "HLT"
+}' > "$WORK_DIR/big.txt"
+
+bytes=$( wc -c < "$WORK_DIR/big.txt" )
+
+run() {
+    start=$( date +%s.%N )
+    ./assembler -i "$WORK_DIR/big.txt" -o "$WORK_DIR/big.$1.bin" -j "$1" > /dev/null 2>&1 || { echo "Assembler failed ( -j $1 )"; rm -r "$WORK_DIR"; exit 1; }
+    end=$( date +%s.%N )
+
+    awk -v j="$1" -v s="$start" -v e="$end" -v b="$bytes" 'BEGIN {
+        printf "-j %-3s assemble = %.3f s; throughput = %.1f MB/s \n", j, e - s, b / 1e6 / ( e - s )
+    }'
+}
+
+echo "source = $( awk -v b="$bytes" 'BEGIN { printf "%.1f", b / 1e6 }' ) MB"
+run 1
+run "$THREADS"
+
+cmp -s "$WORK_DIR/big.1.bin" "$WORK_DIR/big.$THREADS.bin" && echo "Byte code is identical" || echo "Byte code differs"
+
+rm -r "$WORK_DIR"
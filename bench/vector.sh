@@ -0,0 +1,132 @@
+#!/bin/sh
+
+# Векторные команды против тех же вычислений циклом байт-кода: c = a + b и скалярное произведение a и b
+# над массивами по N слов, REPEAT раз. Для векторной версии - ядра AVX2 ( если есть ) и скалярные ( -V ).
+# Обе версии выводят одни и те же контрольные суммы.
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh и ./src/Processor/mk-processor.sh
+
+ENGINES="switch threaded tos jit"
+N=${N:-100000}
+REPEAT=${REPEAT:-100}
+WORK_DIR=$( mktemp -d )
+
+# a - с адреса 0, b - с N, c - с 2N; a[i] = 2, b[i] = 3
+awk -v n="$N" -v repeat="$REPEAT" 'BEGIN {
+    print "MEMSET 0, 2, " n
+    print "MEMSET " n ", 3, " n
+    print "PUSH 0"
+    print "POPR RAX"
+    print ":repeat"
+    print "PUSHR RAX"
+    print "PUSH " repeat
+    print "JAE :done"
+
+    print "PUSH 0"
+    print "POPR RCX"
+    print ":add"
+    print "PUSHR RCX"
+    print "PUSH " n
+    print "JAE :add_done"
+    print "PUSHM [RCX]"
+    print "PUSHR RCX"
+    print "PUSH " n
+    print "ADD"
+    print "POPR RDX"
+    print "PUSHM [RDX]"
+    print "ADD"
+    print "PUSHR RCX"
+    print "PUSH " 2 * n
+    print "ADD"
+    print "POPR RDX"
+    print "POPM [RDX]"
+    print "PUSHR RCX"
+    print "PUSH 1"
+    print "ADD"
+    print "POPR RCX"
+    print "JMP :add"
+    print ":add_done"
+
+    print "PUSH 0"
+    print "POPR RBX"
+    print "PUSH 0"
+    print "POPR RCX"
+    print ":dot"
+    print "PUSHR RCX"
+    print "PUSH " n
+    print "JAE :dot_done"
+    print "PUSHM [RCX]"
+    print "PUSHR RCX"
+    print "PUSH " n
+    print "ADD"
+    print "POPR RDX"
+    print "PUSHM [RDX]"
+    print "MUL"
+    print "PUSHR RBX"
+    print "ADD"
+    print "POPR RBX"
+    print "PUSHR RCX"
+    print "PUSH 1"
+    print "ADD"
+    print "POPR RCX"
+    print "JMP :dot"
+    print ":dot_done"
+
+    print "PUSHR RAX"
+    print "PUSH 1"
+    print "ADD"
+    print "POPR RAX"
+    print "JMP :repeat"
+    print ":done"
+    print "VSUM " 2 * n ", " n
+    print "OUT"
+    print "PUSHR RBX"
+    print "OUT"
+    print "HLT"
+}' > "$WORK_DIR/loop.txt"
+
+awk -v n="$N" -v repeat="$REPEAT" 'BEGIN {
+    print "MEMSET 0, 2, " n
+    print "MEMSET " n ", 3, " n
+    print "PUSH 0"
+    print "POPR RAX"
+    print ":repeat"
+    print "PUSHR RAX"
+    print "PUSH " repeat
+    print "JAE :done"
+    print "VADD " 2 * n ", 0, " n ", " n
+    print "VDOT 0, " n ", " n
+    print "POPR RBX"
+    print "PUSHR RAX"
+    print "PUSH 1"
+    print "ADD"
+    print "POPR RAX"
+    print "JMP :repeat"
+    print ":done"
+    print "VSUM " 2 * n ", " n
+    print "OUT"
+    print "PUSHR RBX"
+    print "OUT"
+    print "HLT"
+}' > "$WORK_DIR/vector.txt"
+
+RAM_WORDS=$(( 3 * N ))
+
+run() {
+    name=$1
+    shift
+
+    ./assembler -i "$WORK_DIR/$name.txt" -o "$WORK_DIR/$name.bc" > /dev/null || exit 1
+
+    for engine in $ENGINES; do
+        printf "%-10s %-10s %-4s " "$name" "$engine" "$*"
+        ./processor -i "$WORK_DIR/$name.bc" -M "$RAM_WORDS" -e "$engine" -s "$@" 2>&1 |
+            awk '/^Output:/ { sums = sums " " $2 } /executed =/ { sub( /.*time = /, "" ); sub( /; speed.*/, "" ); time = $0 }
+                 END { print time ";" sums }'
+    done
+}
+
+run loop
+run vector
+run vector -V
+
+rm -r "$WORK_DIR"
@@ -8,6 +8,7 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <assert.h>
 
@@ -32,18 +33,89 @@ struct FileStat {
     off_t  size   = 0;
 };
 
+#ifdef _PROC
+enum Engine_t {
+    ENGINE_SWITCH   = 0,  // Эталонный интерпретатор: switch + вызовы Proc*
+    ENGINE_THREADED = 1,  // Прямой шитый код на computed goto
+    ENGINE_TOS      = 2,  // Шитый код с кэшированием вершины стека
+    ENGINE_JIT      = 3   // Компиляция в машинный код x86-64
+};
+
+// Как отображается образ RAM ( -m file, режим задает -w )
+enum RamImageMode_t {
+    RAM_IMAGE_PRIVATE = 0,  // Копирование при записи: файл не меняется
+    RAM_IMAGE_SHARED  = 1,  // Запись сразу видна другим процессам, отобразившим файл
+    RAM_IMAGE_SYNC    = 2   // Как SHARED, и после HLT RAM сбрасывается на диск ( msync )
+};
+#endif
+
+#ifdef _ASM
+enum OutputFormat_t {
+    OUTPUT_BINARY = 0,  // Двоичный исполняемый файл (ExeHeader_t + слова кода)
+    OUTPUT_TEXT   = 1,  // Текстовый байт-код "count v v v ..."
+    OUTPUT_C      = 2   // Самостоятельная единица трансляции на C
+};
+#endif
+
+// Параметры командной строки
+struct Options_t {
+    ON_ASM( OutputFormat_t format  = OUTPUT_BINARY; )
+    ON_ASM( size_t         threads = 1;             )  // Потоков ассемблирования, больше 1 - файл делится на части
+    ON_ASM( int            optimize = 0;            )  // Уровень оптимизации байт-кода ( -O1, -O2 )
+
+    ON_ASM( char*          cache_dir   = NULL;      )  // Каталог кэша результатов ( -c ), NULL - без кэша
+    ON_ASM( size_t         cache_limit = 64 << 20;  )  // Размер кэша в байтах ( -l задает в мегабайтах )
+
+    bool stats = false;  // Процессор: число инструкций и скорость; ассемблер: счетчики кэша
+
+    ON_PROC( Engine_t engine = ENGINE_SWITCH; )
+    ON_PROC( bool     fuse   = true;          )  // Сливать частые последовательности в суперинструкции
+    ON_PROC( bool     simd   = true;          )  // Векторные команды на AVX2, если он есть ( -V - скалярные ядра )
+    ON_PROC( bool     fast   = true;          )  // Проверенная верификатором программа - без проверок стека ( -C - с ними )
+
+    ON_PROC( size_t   stack_size        = 8;     )  // Начальные емкости стеков
+    ON_PROC( size_t   refund_stack_size = 5;     )
+    ON_PROC( bool     never_shrink      = false; )  // Стеки только растут
+    ON_PROC( bool     sscanf_loader     = false; )  // Прежний разбор текстового байт-кода (для сравнения)
+
+    ON_PROC( size_t   ram_size = RAM_DEFAULT_SIZE; )  // Слов оперативной памяти ( -M )
+
+    ON_PROC( char*          ram_image      = NULL;              )  // Файл образа RAM ( -m ), NULL - без образа
+    ON_PROC( RamImageMode_t ram_image_mode = RAM_IMAGE_PRIVATE; )
+
+    ON_PROC( char*    batch_manifest    = NULL;  )  // Манифест пакетного режима ( -b )
+    ON_PROC( size_t   threads           = 0;     )  // Потоков в пакетном режиме, 0 - по числу ядер
+};
+
 struct StrPar{
-    char* ptr = NULL;
+    const char* ptr = NULL;
     size_t len = 0;
 };
 
-void ArgvProcessing( int argc, char** argv, ON_ASM( FileStat* asm_file, ) FileStat* exe_file );
+// Текстовый файл в памяти только для чтения. За последним байтом всегда '\0' ( text[size] ):
+// хвост последней страницы отображения заполнен нулями, а файл длиной ровно в целые страницы
+// или неотображаемый читается в буфер
+struct TextFile_t {
+    const char* text           = NULL;
+    size_t      size           = 0;
+    void*       map            = NULL;  // Отображение файла или NULL, если текст в buffer
+    size_t      map_size       = 0;
+    char*       buffer         = NULL;
+    StrPar*     lines          = NULL;  // Индекс строк ( IndexLines ): начало и длина до ';' или '\n'
+    size_t      lines_count    = 0;
+    size_t      lines_capacity = 0;
+};
+
+void ArgvProcessing( int argc, char** argv, ON_ASM( FileStat* asm_file, ) FileStat* exe_file, Options_t* options );
 
-size_t RowCounter( const char* text );
 off_t DetermineFileSize( const char* file_address );
-bool IsEmptyString(const char* str, size_t len);
-size_t SplitIntoLines( StrPar* strings, char* text, const size_t nLines );
 
-char* ReadToBuffer( FileStat* input_file );
+bool   MapTextFile  ( FileStat* input_file, TextFile_t* text );  // false - файл не открывается
+size_t IndexLines   ( TextFile_t* text );                        // Один проход по тексту, возвращает число строк
+void   UnmapTextFile( TextFile_t* text );
+
+// Части parts пишутся одним writev во временный файл рядом с file_address, который затем
+// переименовывается: читатель видит либо прежний файл, либо новый целиком
+bool WriteFileAtomic( const char* file_address, const struct iovec* parts, int parts_count );
 
 #endif // FILERWUTILS_H
\ No newline at end of file
@@ -11,9 +11,13 @@
 #define PASS
 
 
-const size_t MAX_INSTRUCT_LEN = 10;
-const size_t LABELS_NUMBER    = 100;  // Увеличено с 10 на 100
-const size_t MAX_LABEL_LEN    = 32;   // Максимальная длина имени метки
+const int SUCCESS_RESULT = 1;
+const int FAIL_RESULT    = 0;
+
+const size_t MAX_ARGUMENT_LEN = 32;     // Буфер разбора аргумента (имена меток читаются без копирования)
+
+const size_t LABELS_INITIAL_CAPACITY = 64;     // Начальное число ячеек хэш-таблицы (степень двойки)
+const size_t LABEL_ARENA_BLOCK_SIZE  = 65536;  // Размер блока арены для имен меток
 
 enum AssemblerStatus_t {
     SUCCESS,
@@ -23,50 +27,122 @@ enum AssemblerStatus_t {
     UNKNOWN_ERROR
 };
 
-// Структура для хранения метки с именем
+// Метка: имя хранится в арене таблицы и не перемещается при росте таблицы
 struct Label_t {
-    char name[MAX_LABEL_LEN];
-    int address;
+    const char* name    = NULL;  // NULL - свободная ячейка
+    size_t      length  = 0;
+    uint64_t    hash    = 0;
+    int         address = -1;
+};
+
+// Блок арены: имена меток копируются сюда подряд, блоки освобождаются вместе с таблицей
+struct LabelArenaBlock_t {
+    LabelArenaBlock_t* prev     = NULL;
+    char*              data     = NULL;
+    size_t             used     = 0;
+    size_t             capacity = 0;
+};
+
+// Хэш-таблица меток с открытой адресацией (линейное пробирование)
+struct LabelTable_t {
+    Label_t*           slots    = NULL;
+    size_t             capacity = 0;     // Число ячеек, степень двойки
+    size_t             count    = 0;     // Число меток
+    LabelArenaBlock_t* arena    = NULL;  // Текущий блок арены
+};
+
+// Ссылка вперед: слово байт-кода, в которое ResolveFixups запишет адрес метки
+struct Fixup_t {
+    const char* name    = NULL;  // Имя метки в буфере исходного текста
+    size_t      length  = 0;
+    size_t      word    = 0;     // Индекс слова-операнда в byte_code
+    size_t      line    = 0;     // Номер строки и ее начало в буфере (для сообщения об ошибке)
+    const char* source  = NULL;
+    int         command = 0;
 };
 
 struct Assembler_t {
     FileStat asm_file                    = {};
     FileStat exe_file                    = {};
+    Options_t options                    = {};
     size_t   instruction_cnt             = 0;
     int*     byte_code                   = NULL;
-    Label_t  labels[LABELS_NUMBER]       = {};  // Массив структур для меток
-    size_t   labels_count                = 0;   // Количество найденных меток
+    size_t   code_capacity               = 0;     // Слов в byte_code, растет вдвое ( EmitWord )
+    LabelTable_t labels                  = {};  // Таблица меток
+    Fixup_t* fixups                      = NULL;  // Ссылки на еще не объявленные метки
+    size_t   fixups_count                = 0;
+    size_t   fixups_capacity             = 0;
+    bool     defer_labels                = false;  // Все ссылки на метки - через fixups (части файла при -j)
+    char*    cache_entry                 = NULL;   // Запись кэша для этого исходника ( -c )
+    bool     cache_hit                   = false;
 };
 
-enum ArgumentType {
-    UNKNOWN  = -1,
-    VOID     = 0,
-    NUMBER   = 1,
-    REGISTER = 2,
-    LABEL    = 3
+enum TokenType_t {
+    TOKEN_END      = 0,  // Конец строки или комментарий
+    TOKEN_WORD     = 1,  // Мнемоника или нераспознанное слово
+    TOKEN_NUMBER   = 2,
+    TOKEN_REGISTER = 3,  // RAX или AX
+    TOKEN_MEMORY   = 4,  // [RAX]
+    TOKEN_LABEL    = 5   // :name
 };
 
-struct Argument {
-    ArgumentType type = VOID;
-    int value = 0;
+// Токен - указатель и длина прямо в буфере исходного текста ( lexer.cpp )
+struct Token_t {
+    TokenType_t type   = TOKEN_END;
+    const char* ptr    = NULL;
+    size_t      len    = 0;
+    int         value  = 0;  // Число или номер регистра
+    size_t      line   = 0;  // Позиция для сообщений об ошибках, с 1
+    size_t      column = 0;
+};
+
+struct Lexer_t {
+    const char* cursor     = NULL;
+    const char* end        = NULL;
+    const char* line_start = NULL;
+    size_t      line       = 1;
 };
 
 void AssemblerCtor( Assembler_t* assembler, int argc, char** argv );
 void AssemblerDtor( Assembler_t* assembler );
 
 int AsmCodeToByteCode( Assembler_t* assembler );
-int TranslateAsmToByteCode( Assembler_t* assembler, StrPar* strings );
-int AsmCodeProcessing( char* instruction );
-int RegisterNameProcessing( char* name );
-int ArgumentProcessing( Argument* argument, const char* string );
+void ReserveByteCode( Assembler_t* assembler, size_t words );  // Емкость byte_code не меньше words
+
+int TranslateAsmToByteCode( Assembler_t* assembler, const char* buffer, size_t size );
+int TranslateLines        ( Assembler_t* assembler, Lexer_t* lexer, bool* has_hlt );  // Строки от lexer до конца его буфера
+int TranslateAsmParallel  ( Assembler_t* assembler, const TextFile_t* source );       // -j N ( parallel.cpp )
+
+void LexerCtor  ( Lexer_t* lexer, const char* buffer, size_t size );
+bool LexToken   ( Lexer_t* lexer, Token_t* token );  // false - строка закончилась ( token->type == TOKEN_END )
+bool LexNextLine( Lexer_t* lexer );                  // false - закончился буфер
 
-// Новые функции для работы с метками
-int FindLabelAddress( const Assembler_t* assembler, const char* label_name );
-int AddLabel( Assembler_t* assembler, const char* label_name, int address );
+// Таблица меток ( labels.cpp ): имя метки задается указателем и длиной, без завершающего '\0'
+void LabelTableCtor( LabelTable_t* table );
+void LabelTableDtor( LabelTable_t* table );
+size_t LabelTableCompact( LabelTable_t* table );  // Удаляет метки с адресом -1, возвращает их число
+
+int FindLabelAddress( const Assembler_t* assembler, const char* label_name, size_t length );
+int AddLabel( Assembler_t* assembler, const char* label_name, size_t length, int address );
+
+// Слово byte_code[ word ] строки line ссылается на еще не объявленную метку
+void AddFixup     ( Assembler_t* assembler, const char* label_name, size_t length, size_t word,
+                    size_t line, const char* source, int command );
+int  ResolveFixups( Assembler_t* assembler );
+
+size_t OptimizeByteCode( Assembler_t* assembler );  // -O1, -O2 ( optimizer.cpp ): возвращает число удаленных инструкций
 
 AssemblerStatus_t AssemblerVerify( Assembler_t* assembler );
 AssemblerStatus_t AssemblerDump( Assembler_t* assembler );
 
-void OutputInFile(Assembler_t* assembler );
+// Файл пишется одним вызовом во временный файл рядом и переименовывается в exe_file
+int  OutputInFile      ( Assembler_t* assembler );
+int  OutputInBinaryFile( Assembler_t* assembler );
+int  OutputInCFile     ( Assembler_t* assembler );  // -f c: программа на C вместо байт-кода
+
+// Кэш результатов ( cache.cpp ): CacheLookup - true, если exe_file взят из кэша
+bool CacheLookup    ( Assembler_t* assembler );
+void CacheStore     ( Assembler_t* assembler );  // После успешной записи exe_file
+void CachePrintStats( const Assembler_t* assembler );
 
 #endif //ASSEMBLER_H
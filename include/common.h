@@ -1,39 +1,33 @@
 #ifndef COMMON_H
 #define COMMON_H
 
-enum ASM_CMD {
-    PUSH_CMD  = 1,
-    POP_CMD   = 2,
-    ADD_CMD   = 3,
-    SUB_CMD   = 4,
-    MUL_CMD   = 5,
-    DIV_CMD   = 6,
-    POW_CMD   = 7,
-    SQRT_CMD  = 8,
-    IN_CMD    = 9,
-    OUT_CMD   = 10,
-    JMP_CMD   = 11,
-    JB_CMD    = 12,
-    JA_CMD    = 13,
-    JBE_CMD   = 14,
-    JAE_CMD   = 15,
-    JE_CMD    = 16,
-    HLT_CMD   = 17,
-    CALL_CMD  = 28,
-    RET_CMD   = 29,
-    MARK_CMD  = 30,
-    PUSHR_CMD = 33,
-    POPR_CMD  = 34,
-    PUSHM_CMD = 35,  // Цитирование из RAM по адресу в регистре
-    POPM_CMD  = 36   // Запись в RAM по адресу в регистре
-};
+#include <stdint.h>
+
+#include "opcodes.h"
+
+const int REGS_NUMBER = 10;
 
-// struct Commands_t {
-//     int command_number = 0;
-//     void* function_pointer = NULL;
-//     int number_of_parameters = 0;
-// } commands[] = {
+// Оперативная память в словах: размер задает -M, страницы выделяются при первом обращении.
+// Адрес в байт-коде - int, поэтому слов не больше INT32_MAX.
+const size_t RAM_DEFAULT_SIZE = 1 << 20;
+const size_t RAM_MAX_SIZE     = INT32_MAX;
 
-// };
+// Двоичный исполняемый файл: заголовок, затем секции из 32-битных слов little-endian.
+// Смещения - в байтах от начала файла, размеры - в словах.
+const uint32_t EXE_MAGIC   = 0x4D565053;  // "SPVM"
+const uint32_t EXE_VERSION = 2;  // 2 - прямой адрес в RAM кодируется командами PUSHMA/POPMA
+
+const uint32_t EXE_FLAG_ENTRY = 1u << 0;  // Поле entry задано, иначе исполнение начинается с адреса 0
+
+struct ExeHeader_t {
+    uint32_t magic       = EXE_MAGIC;
+    uint32_t version     = EXE_VERSION;
+    uint32_t flags       = 0;
+    uint32_t code_offset = 0;  // Секция кода
+    uint32_t code_size   = 0;
+    uint32_t ram_offset  = 0;  // Начальное содержимое RAM (необязательно, ram_size == 0 - нет секции)
+    uint32_t ram_size    = 0;
+    uint32_t entry       = 0;  // Адрес слова точки входа
+};
 
 #endif
\ No newline at end of file
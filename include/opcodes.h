@@ -0,0 +1,174 @@
+#ifndef OPCODES_H
+#define OPCODES_H
+
+#include <stddef.h>
+#include <string.h>
+
+// Единственное описание команд байт-кода. Из него строятся перечисление ASM_CMD,
+// таблица OPCODES (ассемблер, C-бэкенд) и таблица обработчиков процессора ( commands.cpp ).
+//
+// DEF_CMD( имя, код, вид операнда, другая форма, снимает со стека, кладет на стек, обработчик процессора )
+// Другая форма - команда, в которую превращается запись с операндом, не подходящим основной:
+// PUSH RAX -> PUSHR RAX, PUSHM 5 -> PUSHMA 5.
+//
+// MEMSET, MEMCPY и MEMCMP берут операнды со стека в порядке одноименных функций C:
+// PUSH dst; PUSH value; PUSH count; MEMSET  ->  RAM[ dst .. dst + count ) = value
+// PUSH dst; PUSH src;   PUSH count; MEMCPY  ->  копирование, диапазоны могут перекрываться
+// PUSH a;   PUSH b;     PUSH count; MEMCMP  ->  на стеке -1, 0 или 1 по первому различию
+// Векторные команды так же работают над диапазонами RAM длины len:
+// PUSH dst; PUSH a; PUSH b; PUSH len; VADD  ->  dst[i] = a[i] + b[i]    ( VMUL - произведения )
+// PUSH a;   PUSH len;               VSUM  ->  на стеке сумма a[i]
+// PUSH a;   PUSH b;   PUSH len;     VDOT  ->  на стеке сумма a[i] * b[i]
+// В ассемблере операнды этих команд можно записать и в строке: VADD 100, 200, RAX, RCX ( см. ListOperands )
+#define OPCODES_TABLE( DEF_CMD )                                          \
+    DEF_CMD( PUSH,     1, OPERAND_NUMBER,   PUSHR_CMD,  0, 1, ProcPush     )    \
+    DEF_CMD( POP,      2, OPERAND_NONE,     POPR_CMD,   1, 0, ProcPop      )    \
+    DEF_CMD( ADD,      3, OPERAND_NONE,     0,          2, 1, ProcAdd      )    \
+    DEF_CMD( SUB,      4, OPERAND_NONE,     0,          2, 1, ProcSub      )    \
+    DEF_CMD( MUL,      5, OPERAND_NONE,     0,          2, 1, ProcMul      )    \
+    DEF_CMD( DIV,      6, OPERAND_NONE,     0,          2, 1, ProcDiv      )    \
+    DEF_CMD( POW,      7, OPERAND_NONE,     0,          2, 1, ProcPow      )    \
+    DEF_CMD( SQRT,     8, OPERAND_NONE,     0,          1, 1, ProcSqrt     )    \
+    DEF_CMD( IN,       9, OPERAND_NONE,     0,          0, 1, ProcIn       )    \
+    DEF_CMD( OUT,     10, OPERAND_NONE,     0,          1, 0, ProcOut      )    \
+    DEF_CMD( JMP,     11, OPERAND_LABEL,    0,          0, 0, ProcJmp      )    \
+    DEF_CMD( JB,      12, OPERAND_LABEL,    0,          2, 0, ProcJb       )    \
+    DEF_CMD( JA,      13, OPERAND_LABEL,    0,          2, 0, ProcJa       )    \
+    DEF_CMD( JBE,     14, OPERAND_LABEL,    0,          2, 0, ProcJbe      )    \
+    DEF_CMD( JAE,     15, OPERAND_LABEL,    0,          2, 0, ProcJae      )    \
+    DEF_CMD( JE,      16, OPERAND_LABEL,    0,          2, 0, ProcJe       )    \
+    DEF_CMD( HLT,     17, OPERAND_NONE,     0,          0, 0, NULL         )    \
+    DEF_CMD( CALL,    28, OPERAND_LABEL,    0,          0, 0, ProcCall     )    \
+    DEF_CMD( RET,     29, OPERAND_NONE,     0,          0, 0, ProcRet      )    \
+    DEF_CMD( PUSHR,   33, OPERAND_REGISTER, 0,          0, 1, ProcPushR    )    \
+    DEF_CMD( POPR,    34, OPERAND_REGISTER, 0,          1, 0, ProcPopR     )    \
+    DEF_CMD( PUSHM,   35, OPERAND_MEMORY,   PUSHMA_CMD, 0, 1, ProcPushM    )    \
+    DEF_CMD( POPM,    36, OPERAND_MEMORY,   POPMA_CMD,  1, 0, ProcPopM     )    \
+    DEF_CMD( PUSHMA,  37, OPERAND_ADDRESS,  0,          0, 1, ProcPushMAbs )    \
+    DEF_CMD( POPMA,   38, OPERAND_ADDRESS,  0,          1, 0, ProcPopMAbs  )    \
+    DEF_CMD( MEMSET,  39, OPERAND_NONE,     0,          3, 0, ProcMemset   )    \
+    DEF_CMD( MEMCPY,  40, OPERAND_NONE,     0,          3, 0, ProcMemcpy   )    \
+    DEF_CMD( MEMCMP,  41, OPERAND_NONE,     0,          3, 1, ProcMemcmp   )    \
+    DEF_CMD( VADD,    42, OPERAND_NONE,     0,          4, 0, ProcVadd     )    \
+    DEF_CMD( VMUL,    43, OPERAND_NONE,     0,          4, 0, ProcVmul     )    \
+    DEF_CMD( VSUM,    44, OPERAND_NONE,     0,          2, 1, ProcVsum     )    \
+    DEF_CMD( VDOT,    45, OPERAND_NONE,     0,          3, 1, ProcVdot     )
+
+#define DEF_ENUM( name, code, operand, other_form, pops, pushes, handler ) name##_CMD = code,
+
+enum ASM_CMD {
+    OPCODES_TABLE( DEF_ENUM )
+    MARK_CMD = 30  // Объявление метки - только в ассемблере, в байт-код не попадает
+};
+
+#undef DEF_ENUM
+
+enum OperandKind_t {
+    OPERAND_NONE     = 0,
+    OPERAND_NUMBER   = 1,  // Непосредственное число
+    OPERAND_REGISTER = 2,  // Номер регистра
+    OPERAND_MEMORY   = 3,  // [регистр] - адрес в RAM из регистра, операнд - номер регистра
+    OPERAND_LABEL    = 4,  // :метка - адрес слова байт-кода
+    OPERAND_ADDRESS  = 5   // Прямой адрес в RAM
+};
+
+struct Opcode_t {
+    const char*   name          = NULL;
+    size_t        length        = 0;
+    int           code          = 0;
+    OperandKind_t operand       = OPERAND_NONE;
+    int           other_form    = 0;
+    size_t        size          = 0;  // Слов байт-кода вместе с операндом
+    size_t        pops          = 0;  // Значений, которые команда снимает с верхушки стека
+    size_t        pushes        = 0;  // И кладет на нее после этого ( верификатор байт-кода )
+};
+
+#define DEF_OPCODE( name, code, operand, other_form, pops, pushes, handler ) \
+    { #name, sizeof( #name ) - 1, code, operand, other_form, ( operand == OPERAND_NONE ) ? 1u : 2u, pops, pushes },
+
+inline constexpr Opcode_t OPCODES[] = {
+    OPCODES_TABLE( DEF_OPCODE )
+};
+
+#undef DEF_OPCODE
+
+inline constexpr size_t OPCODES_COUNT = sizeof( OPCODES ) / sizeof( *OPCODES );
+
+// Сколько операндов со стека команда принимает записанными в строке ( ассемблер превращает их в PUSH/PUSHR ),
+// 0 - у команды такой записи нет
+constexpr size_t ListOperands( int code ) {
+    switch ( code ) {
+        case MEMSET_CMD: case MEMCPY_CMD: case MEMCMP_CMD: case VDOT_CMD: return 3;
+        case VADD_CMD:   case VMUL_CMD:                                   return 4;
+        case VSUM_CMD:                                                    return 2;
+        default:                                                          return 0;
+    }
+}
+
+const size_t MAX_LIST_OPERANDS = 4;
+
+// Мнемоника ищется одной выборкой по совершенной хэш-функции от первых двух и последнего символа
+// и длины ( PUSHM и PUSHMA отличаются только ими ); отсутствие коллизий проверяет static_assert ниже
+const size_t OPCODE_HASH_SIZE  = 128;
+const size_t OPCODE_CODES_SIZE = 64;  // Коды команд байт-кода меньше этого числа
+
+constexpr size_t OpcodeHash( const char* name, size_t length ) {
+    return ( 2u * ( unsigned char ) name[0] + ( unsigned char ) name[1] + 4u * ( unsigned char ) name[ length - 1 ] + length )
+           & ( OPCODE_HASH_SIZE - 1 );
+}
+
+struct OpcodeIndex_t {
+    int  by_hash[ OPCODE_HASH_SIZE  ] = {};  // Индекс в OPCODES или -1
+    int  by_code[ OPCODE_CODES_SIZE ] = {};
+    bool perfect                      = true;
+};
+
+constexpr OpcodeIndex_t BuildOpcodeIndex() {
+    OpcodeIndex_t index = {};
+
+    for ( size_t i = 0; i < OPCODE_HASH_SIZE;  i++ ) index.by_hash[i] = -1;
+    for ( size_t i = 0; i < OPCODE_CODES_SIZE; i++ ) index.by_code[i] = -1;
+
+    for ( size_t i = 0; i < OPCODES_COUNT; i++ ) {
+        const Opcode_t& opcode = OPCODES[i];
+        size_t hash = OpcodeHash( opcode.name, opcode.length );
+
+        if ( opcode.length < 2 || index.by_hash[ hash ] != -1 ||
+             opcode.code <= 0  || ( size_t ) opcode.code >= OPCODE_CODES_SIZE || index.by_code[ opcode.code ] != -1 ) {
+            index.perfect = false;
+            continue;
+        }
+
+        index.by_hash[ hash ]        = ( int ) i;
+        index.by_code[ opcode.code ] = ( int ) i;
+    }
+
+    return index;
+}
+
+inline constexpr OpcodeIndex_t OPCODE_INDEX = BuildOpcodeIndex();
+
+static_assert( OPCODE_INDEX.perfect, "Opcode table: hash collision or bad command code, change OpcodeHash or the code" );
+
+// Мнемоника задается указателем и длиной; сравнивается целиком, так что PUSHX или HLTZ не опознаются
+inline const Opcode_t* FindOpcode( const char* name, size_t length ) {
+    if ( length < 2 ) return NULL;
+
+    int index = OPCODE_INDEX.by_hash[ OpcodeHash( name, length ) ];
+    if ( index < 0 ) return NULL;
+
+    const Opcode_t* opcode = OPCODES + index;
+    if ( opcode->length != length || memcmp( opcode->name, name, length ) != 0 ) return NULL;
+
+    return opcode;
+}
+
+inline const Opcode_t* FindOpcodeByCode( int code ) {
+    if ( code <= 0 || ( size_t ) code >= OPCODE_CODES_SIZE ) return NULL;
+
+    int index = OPCODE_INDEX.by_code[ code ];
+
+    return ( index < 0 ) ? NULL : OPCODES + index;
+}
+
+#endif // OPCODES_H
@@ -2,13 +2,11 @@
 #define PROCESSOR_H
 
 #include <ctype.h>
+#include <stdint.h>
 
 #include "FileRWUtils.h"
 #include "stack.h"
 
-const int REGS_NUMBER = 10;
-const int RAM_SIZE = 100;  // Оперативная память - 100 элементов
-
 enum ProcessorStatus_t {
     SUCCESS,
     FILE_NOT_FOUND,
@@ -16,17 +14,85 @@ enum ProcessorStatus_t {
     UNKNOWN_ERROR
 };
 
+// Команды декодированного потока, которых нет в байт-коде
+enum DecodedCmd_t {
+    // Суперинструкции (см. FuseInstructions)
+    REG_ADD_IMM_CMD = 66,  // PUSHR r; PUSH k; ADD/SUB; POPR r  ->  r += k
+    JB_REG_IMM_CMD  = 67,  // PUSHR r; PUSH k; JB :n            ->  if ( r <  k ) goto n
+    JA_REG_IMM_CMD  = 68,  // ... JA
+    JBE_REG_IMM_CMD = 69,  // ... JBE
+    JAE_REG_IMM_CMD = 70,  // ... JAE
+    JE_REG_IMM_CMD  = 71,  // ... JE
+    LOAD_CONST_CMD  = 72,  // PUSH n; POPR r; PUSHM [r]         ->  r = n; PUSH RAM[n]
+    STORE_CONST_CMD = 73   // PUSH n; POPR r; POPM [r]          ->  r = n; POP  RAM[n]
+};
+
+const int COMMANDS_NUMBER = STORE_CONST_CMD + 1;
+
+// Длины последовательностей, заменяемых суперинструкциями
+const size_t REG_ADD_IMM_LEN = 4;
+const size_t JCC_REG_IMM_LEN = 3;
+const size_t CONST_RAM_LEN   = 3;
+
+struct Processor_t;
+struct Instr_t;
+
+typedef void ( *ProcHandler_t )( Processor_t* processor, const Instr_t* instr );
+
+// Инструкция после декодирования байт-кода: операнды уже разобраны по видам,
+// адрес перехода - индекс в декодированном потоке
+struct Instr_t {
+    ProcHandler_t handler = NULL;  // Внешний обработчик Proc*
+    const void*   label   = NULL;  // Обработчик шитого движка (заполняет ByteCodeProcessingThreaded)
+    int           command = 0;
+    int           reg     = 0;     // Номер регистра
+    StackData_t   imm     = 0;     // Непосредственное значение
+    int           addr    = 0;     // Абсолютный адрес в RAM
+    size_t        target  = 0;     // Индекс перехода
+};
+
+// Описание команды байт-кода для декодера
+struct Command_t {
+    int           command     = 0;
+    ProcHandler_t handler     = NULL;
+    OperandKind_t operand     = OPERAND_NONE;
+    size_t        args_number = 0;
+};
+
+extern const Command_t commands[];
+extern const size_t    commands_count;
+
 struct Processor_t {
     Stack_t stk                     = {};
     Stack_t refund_stk              = {};
-    int* byte_code                  = NULL;
-    int* RAM                        = NULL;  // Оперативная память
-    size_t instruction_ptr          = 0;
-    size_t instruction_count        = 0;
+    const int* byte_code            = NULL;  // Слова байт-кода: в text_code или в отображении файла
+    int* text_code                  = NULL;  // Байт-код, прочитанный из текстового формата
+    void* exe_map                   = NULL;  // mmap двоичного файла (только чтение)
+    size_t exe_map_size             = 0;
+    size_t entry_word               = 0;     // Адрес слова точки входа
+    bool sscanf_loader              = false; // Текстовый формат разбирается прежним циклом sscanf
+    FILE* in                        = stdin;  // Потоки IN и OUT: в пакетном режиме у каждого запуска свои
+    FILE* out                       = stderr;
+    Instr_t* code                   = NULL;  // Декодированный поток (code_size инструкций + конец программы)
+    int* RAM                        = NULL;  // Оперативная память: анонимное отображение ram_size слов
+    size_t ram_size                 = 0;
+    size_t ram_loaded               = 0;     // Слов начального содержимого RAM из исполняемого файла
+    int    ram_image_fd             = -1;    // Открытый файл образа RAM ( OpenRamImage ), -1 - нет
+    size_t ram_image_size           = 0;     // Слов в начале RAM, отображенных из образа
+    RamImageMode_t ram_image_mode   = RAM_IMAGE_PRIVATE;
+    size_t instruction_ptr          = 0;     // Индекс в декодированном потоке
+    size_t instruction_count        = 0;     // Число слов байт-кода
+    size_t code_size                = 0;     // Число декодированных инструкций
+    size_t executed_count           = 0;  // Число исполненных инструкций (для статистики)
+    size_t fused_count              = 0;  // Число суперинструкций, созданных FuseInstructions
+    bool   verified                 = false;     // VerifyByteCode доказал, что стек не опустошается и ограничен
+    bool   fast                     = false;     // Исполнение без проверок стека ( только проверенная программа )
+    size_t max_stack_depth          = 0;         // Наибольшая глубина стека проверенной программы
+    size_t unverified_word          = SIZE_MAX;  // Где на разных путях сошлись разные глубины стека
     StackData_t regs[ REGS_NUMBER ] = {};
 };
 
-void ProcCtor( Processor_t* processor, size_t stack_size, size_t refund_stack_size );
+void ProcCtor( Processor_t* processor, size_t stack_size, size_t refund_stack_size, size_t ram_size );
 void ProcDtor( Processor_t* processor );
 
 
@@ -39,34 +105,104 @@ void ProcDtor( Processor_t* processor );
     void PrintRAM             ( const Processor_t* processor );
 #endif
 
-void ExeFileToByteCode ( Processor_t* processor, FileStat* file );
-int  ByteCodeProcessing( Processor_t* processor );
-void FillInByteCode    ( Processor_t* processor, char* buffer );
-
+ProcessorStatus_t ExeFileToByteCode( Processor_t* processor, FileStat* file );
+ProcessorStatus_t DecodeByteCode   ( Processor_t* processor );
+size_t            FuseInstructions ( Processor_t* processor );
 
-void ProcPush( Processor_t* processor);
-void ProcPop ( Processor_t* processor);
+// Верификатор ( verifier.cpp ): глубина стека по графу потока управления. Отвергает программы,
+// в которых стек опустошается, RET идет без CALL или прямой адрес выходит за RAM
+ProcessorStatus_t VerifyByteCode      ( Processor_t* processor );
+void              ReserveVerifiedStack( Processor_t* processor );  // Емкость стека - max_stack_depth, без сжатия
 
-void ProcAdd ( Processor_t* processor );
-void ProcSub ( Processor_t* processor );
-void ProcDiv ( Processor_t* processor );
-void ProcMul ( Processor_t* processor );
-void ProcPow ( Processor_t* processor );
-void ProcSqrt( Processor_t* processor );
+size_t RamResidentBytes( const Processor_t* processor );  // Сколько RAM уже занято страницами
 
-void ProcIn ( Processor_t* processor );
-void ProcOut( Processor_t* processor );
+// Образ RAM: файл из 32-битных слов little-endian отображается на начало RAM без копирования.
+// OpenRamImage вызывается после загрузки программы - образ заменяет начальную RAM из исполняемого файла
+ProcessorStatus_t OpenRamImage ( Processor_t* processor, const char* address, RamImageMode_t mode );
+ProcessorStatus_t MapRamImage  ( Processor_t* processor, int fd, size_t words, RamImageMode_t mode );
+bool              FlushRamImage( const Processor_t* processor );  // RAM_IMAGE_SYNC: msync после HLT
 
-void ProcPushR( Processor_t* processor );
-void ProcPopR ( Processor_t* processor );
-
-void ProcPushM( Processor_t* processor );  // PUSHM [register]
-void ProcPopM ( Processor_t* processor );  // POPM [register]
-
-void ProcJump( Processor_t* processor );
-
-void ProcCall( Processor_t* processor );
-void ProcRet ( Processor_t* processor );
+int  ByteCodeProcessing( Processor_t* processor );
+int  ByteCodeProcessingThreaded( Processor_t* processor );
+int  ByteCodeProcessingTos     ( Processor_t* processor );  // Шитый движок с вершиной стека в регистре
+int  ByteCodeProcessingJit     ( Processor_t* processor );  // JIT x86-64, при неудаче - ByteCodeProcessing
+
+// JIT по частям: пакетный режим компилирует поток один раз и исполняет его для каждого запуска.
+// JitCompile возвращает NULL, если компиляция невозможна ( движок тогда - ByteCodeProcessing )
+struct JitProgram_t;
+JitProgram_t* JitCompile( Instr_t* code, size_t code_size, size_t ram_size, bool fast );
+int           JitExecute( const JitProgram_t* program, Processor_t* processor );
+void          JitRelease( JitProgram_t* program );
+void FillInByteCode    ( Processor_t* processor, const char* buffer );
+
+// Диапазоны RAM ( memory.cpp ): границы проверяются один раз, ядра работают без проверок
+void CheckRamRange( size_t ram_size, int address, int count );
+void RamFill      ( int* dst, int value, size_t count );
+void RamCopy      ( int* dst, const int* src, size_t count );
+int  RamCompare   ( const int* first, const int* second, size_t count );
+
+// Векторные ядра ( memory.cpp ): AVX2, если его поддерживает процессор, иначе скалярные
+void        SelectVectorKernels( bool simd );  // false - только скалярные ( -V )
+const char* VectorKernelsName  ();
+void RamVectorAdd( int* dst, const int* a, const int* b, size_t count );
+void RamVectorMul( int* dst, const int* a, const int* b, size_t count );
+int  RamVectorSum( const int* a, size_t count );
+int  RamVectorDot( const int* a, const int* b, size_t count );
+
+typedef int ( *ProcEngine_t )( Processor_t* processor );
+
+// Пакетный режим: загруженная программа image исполняется для каждой строки манифеста
+int  ByteCodeProcessingBatch( const Processor_t* image, const Options_t* options, ProcEngine_t engine );
+
+
+void ProcPush( Processor_t* processor, const Instr_t* instr );
+void ProcPop ( Processor_t* processor, const Instr_t* instr );
+
+void ProcAdd ( Processor_t* processor, const Instr_t* instr );
+void ProcSub ( Processor_t* processor, const Instr_t* instr );
+void ProcDiv ( Processor_t* processor, const Instr_t* instr );
+void ProcMul ( Processor_t* processor, const Instr_t* instr );
+void ProcPow ( Processor_t* processor, const Instr_t* instr );
+void ProcSqrt( Processor_t* processor, const Instr_t* instr );
+
+void ProcIn ( Processor_t* processor, const Instr_t* instr );
+void ProcOut( Processor_t* processor, const Instr_t* instr );
+
+void ProcPushR( Processor_t* processor, const Instr_t* instr );
+void ProcPopR ( Processor_t* processor, const Instr_t* instr );
+
+void ProcPushM   ( Processor_t* processor, const Instr_t* instr );  // PUSHM [register]
+void ProcPopM    ( Processor_t* processor, const Instr_t* instr );  // POPM [register]
+void ProcPushMAbs( Processor_t* processor, const Instr_t* instr );  // PUSHM address
+void ProcPopMAbs ( Processor_t* processor, const Instr_t* instr );  // POPM address
+
+void ProcMemset( Processor_t* processor, const Instr_t* instr );
+void ProcMemcpy( Processor_t* processor, const Instr_t* instr );
+void ProcMemcmp( Processor_t* processor, const Instr_t* instr );
+
+void ProcVadd( Processor_t* processor, const Instr_t* instr );
+void ProcVmul( Processor_t* processor, const Instr_t* instr );
+void ProcVsum( Processor_t* processor, const Instr_t* instr );
+void ProcVdot( Processor_t* processor, const Instr_t* instr );
+
+void ProcJmp( Processor_t* processor, const Instr_t* instr );
+void ProcJb ( Processor_t* processor, const Instr_t* instr );
+void ProcJa ( Processor_t* processor, const Instr_t* instr );
+void ProcJbe( Processor_t* processor, const Instr_t* instr );
+void ProcJae( Processor_t* processor, const Instr_t* instr );
+void ProcJe ( Processor_t* processor, const Instr_t* instr );
+
+void ProcCall( Processor_t* processor, const Instr_t* instr );
+void ProcRet ( Processor_t* processor, const Instr_t* instr );
+
+void ProcRegAddImm( Processor_t* processor, const Instr_t* instr );
+void ProcJbRegImm ( Processor_t* processor, const Instr_t* instr );
+void ProcJaRegImm ( Processor_t* processor, const Instr_t* instr );
+void ProcJbeRegImm( Processor_t* processor, const Instr_t* instr );
+void ProcJaeRegImm( Processor_t* processor, const Instr_t* instr );
+void ProcJeRegImm ( Processor_t* processor, const Instr_t* instr );
+void ProcLoadConst ( Processor_t* processor, const Instr_t* instr );
+void ProcStoreConst( Processor_t* processor, const Instr_t* instr );
 
 
 
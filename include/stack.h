@@ -75,6 +75,11 @@ struct Stack_t {
     size_t size       = 0;
     size_t capacity   = 0;
 
+    size_t min_capacity  = 0;      // Ниже начальной емкости стек не сжимается
+    bool   never_shrink  = false;  // Не сжимать стек вовсе
+    size_t realloc_count = 0;      // Статистика: число StackRealloc
+    size_t poison_count  = 0;      // Статистика: число ячеек, заполненных poison
+
     ON_DEBUG( VarInfo varInfo = {}; )
     ON_CANARY( int canary2 = canary; )
 };
@@ -87,7 +92,12 @@ void StackPop ( Stack_t* stk );
 StackData_t StackTop( Stack_t* stk );
 
 void StackRealloc( Stack_t* stk, size_t capacity );
-void StackToPoison( Stack_t* stk );
+void StackToPoison( Stack_t* stk, size_t from );
+
+// Емкость после роста: удвоение
+inline size_t StackGrownCapacity( size_t capacity ) {
+    return ( capacity > 0 ) ? capacity * 2 : 1;
+}
 
 long StackVerify( Stack_t* stk );
 void StackDump  ( const Stack_t* stk );
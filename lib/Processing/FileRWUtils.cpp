@@ -1,9 +1,27 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
 #include "FileRWUtils.h"
 
-void ArgvProcessing( int argc, char** argv, ON_ASM( FileStat* asm_file, ) FileStat* exe_file ) {
+static void ParseCount( const char* string, const char* name, size_t* count ) {
+    char* end = NULL;
+    long value = strtol( string, &end, 10 );
+
+    if ( *end != '\0' || value <= 0 ) {
+        fprintf( stderr, "Warning: incorrect %s \"%s\", %lu will be used \n", name, string, *count );
+        return;
+    }
+
+    *count = ( size_t ) value;
+}
+
+void ArgvProcessing( int argc, char** argv, ON_ASM( FileStat* asm_file, ) FileStat* exe_file, Options_t* options ) {
             my_assert( argv,             ASSERT_ERR_NULL_PTR        )
     ON_ASM( my_assert( asm_file,         ASSERT_ERR_NULL_PTR        ) )
             my_assert( exe_file,         ASSERT_ERR_NULL_PTR        )
+            my_assert( options,          ASSERT_ERR_NULL_PTR        )
 
     PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ )
 
@@ -11,13 +29,70 @@ void ArgvProcessing( int argc, char** argv, ON_ASM( FileStat* asm_file, ) FileSt
             exe_file->address = strdup( "./byte-code.txt" );
 
     int opt = 0;
-    const char* opts = "i:o:";
+    const char* opts = "i:o:j:s" ON_ASM( "f:c:l:O:" ) ON_PROC( "e:FVCS:R:M:m:w:kTb:" );
 
     while ( ( opt = getopt( argc, argv, opts ) ) != -1 ) {
         switch ( opt ) {
             case 'i': ON_ASM( free(asm_file->address); asm_file->address = strdup( optarg ); )
                      ON_PROC( free(exe_file->address); exe_file->address = strdup( optarg ); )   break;
             case 'o': ON_ASM( free(exe_file->address); exe_file->address = strdup( optarg ); )   break;
+            case 'j': ParseCount( optarg, "threads number", &( options->threads ) ); break;
+            case 's': options->stats = true; break;
+
+        #ifdef _ASM
+            case 'f':
+                if      ( strcmp( optarg, "binary" ) == 0 ) options->format = OUTPUT_BINARY;
+                else if ( strcmp( optarg, "text"   ) == 0 ) options->format = OUTPUT_TEXT;
+                else if ( strcmp( optarg, "bytecode" ) == 0 ) options->format = OUTPUT_TEXT;  // Прежнее имя текстового формата
+                else if ( strcmp( optarg, "c"      ) == 0 ) options->format = OUTPUT_C;
+                else fprintf( stderr, "Warning: unknown output format \"%s\", \"binary\" will be used \n", optarg );
+                break;
+            case 'O':
+                if      ( strcmp( optarg, "0" ) == 0 ) options->optimize = 0;
+                else if ( strcmp( optarg, "1" ) == 0 ) options->optimize = 1;
+                else if ( strcmp( optarg, "2" ) == 0 ) options->optimize = 2;
+                else fprintf( stderr, "Warning: unknown optimization level \"%s\", 0 will be used \n", optarg );
+                break;
+            case 'c': free( options->cache_dir ); options->cache_dir = strdup( optarg ); break;
+            case 'l': {
+                size_t megabytes = options->cache_limit >> 20;
+                ParseCount( optarg, "cache size in megabytes", &megabytes );
+                options->cache_limit = megabytes << 20;
+                break;
+            }
+        #endif
+
+        #ifdef _PROC
+            case 'e':
+                if      ( strcmp( optarg, "switch"   ) == 0 ) options->engine = ENGINE_SWITCH;
+                else if ( strcmp( optarg, "threaded" ) == 0 ) options->engine = ENGINE_THREADED;
+                else if ( strcmp( optarg, "tos"      ) == 0 ) options->engine = ENGINE_TOS;
+                else if ( strcmp( optarg, "jit"      ) == 0 ) options->engine = ENGINE_JIT;
+                else fprintf( stderr, "Warning: unknown engine \"%s\", \"switch\" will be used \n", optarg );
+                break;
+            case 'F': options->fuse  = false; break;
+            case 'V': options->simd  = false; break;
+            case 'C': options->fast  = false; break;
+            case 'S': ParseCount( optarg, "stack capacity", &( options->stack_size        ) ); break;
+            case 'R': ParseCount( optarg, "stack capacity", &( options->refund_stack_size ) ); break;
+            case 'M':
+                ParseCount( optarg, "RAM size in words", &( options->ram_size ) );
+                if ( options->ram_size > RAM_MAX_SIZE ) {
+                    fprintf( stderr, "Warning: RAM size %lu is too large, %lu will be used \n", options->ram_size, RAM_MAX_SIZE );
+                    options->ram_size = RAM_MAX_SIZE;
+                }
+                break;
+            case 'm': free( options->ram_image ); options->ram_image = strdup( optarg ); break;
+            case 'w':
+                if      ( strcmp( optarg, "private" ) == 0 ) options->ram_image_mode = RAM_IMAGE_PRIVATE;
+                else if ( strcmp( optarg, "shared"  ) == 0 ) options->ram_image_mode = RAM_IMAGE_SHARED;
+                else if ( strcmp( optarg, "sync"    ) == 0 ) options->ram_image_mode = RAM_IMAGE_SYNC;
+                else fprintf( stderr, "Warning: unknown RAM image mode \"%s\", \"private\" will be used \n", optarg );
+                break;
+            case 'k': options->never_shrink  = true; break;
+            case 'T': options->sscanf_loader = true; break;
+            case 'b': free( options->batch_manifest ); options->batch_manifest = strdup( optarg ); break;
+        #endif
 
             default:
                 ON_ASM( fprintf( stderr, "Warning: asm_file will be \"%s\" \n", asm_file->address ); )
@@ -29,13 +104,9 @@ void ArgvProcessing( int argc, char** argv, ON_ASM( FileStat* asm_file, ) FileSt
     PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
 }
 
-char* ReadToBuffer( FileStat* input_file ) {
+static char* ReadToBuffer( FileStat* input_file ) {
     PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ )
 
-    if ( input_file->size == 0 ) {
-        input_file->size = DetermineFileSize( input_file->address );
-    }
-
     char* buffer = ( char* ) calloc ( ( size_t ) input_file->size + 1, sizeof( *buffer ) );
     my_assert( buffer, ASSERT_ERR_NULL_PTR )
 
@@ -43,80 +114,145 @@ char* ReadToBuffer( FileStat* input_file ) {
     my_assert( file, ASSERT_ERR_FAIL_OPEN )
 
     size_t result_of_read = fread( buffer, sizeof( char ), ( size_t )input_file->size, file );
-    assert( result_of_read != 0 && "Fail read to buffer \n" );
+    assert( result_of_read == ( size_t ) input_file->size && "Fail read to buffer \n" );
 
     int result_of_fclose = fclose( file );
     assert( result_of_fclose == 0 && "Fail close file \n" );
 
-    input_file->nLines = RowCounter( buffer );
     PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
 
     return buffer;
 }
 
-size_t SplitIntoLines( StrPar* strings, char* buffer, size_t nLines ) {
-    my_assert( strings, ASSERT_ERR_NULL_PTR );
-    my_assert( buffer,  ASSERT_ERR_NULL_PTR );
+bool MapTextFile( FileStat* input_file, TextFile_t* text ) {
+    my_assert( input_file, ASSERT_ERR_NULL_PTR );
+    my_assert( text,       ASSERT_ERR_NULL_PTR );
 
-    PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ )
+    *text = {};
 
-    if ( nLines == 0 ) {
-        nLines = RowCounter( buffer );
+    int fd = open( input_file->address, O_RDONLY );
+    if ( fd < 0 ) return false;
+
+    struct stat file_stat = {};
+    if ( fstat( fd, &file_stat ) != 0 ) {
+        close( fd );
+        return false;
     }
 
-    size_t line = 0;
-    size_t actual_line = 0;
-    strings[ actual_line ].ptr = buffer;
-    strings[ actual_line ].len = 0;
+    input_file->size = file_stat.st_size;
+    text->size       = ( size_t ) file_stat.st_size;
 
-    while ( *buffer != '\0' ) {
-        if ( *buffer == ';' ) {
-            *buffer++ = '\0';
-            while ( *buffer != '\n' && *buffer != '\0' ) {
-                buffer++;
-            }
+    // Нулевой хвост есть, только если файл не кончается ровно на границе страницы
+    size_t page_size = ( size_t ) sysconf( _SC_PAGESIZE );
+    if ( text->size % page_size != 0 ) {
+        void* map = mmap( NULL, text->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+        if ( map != MAP_FAILED ) {
+            madvise( map, text->size, MADV_SEQUENTIAL );
+
+            text->map      = map;
+            text->map_size = text->size;
+            text->text     = ( const char* ) map;
         }
+    }
 
-        if ( *buffer == '\n' ) {
-            *buffer = '\0';
+    close( fd );
 
-            if ( strings[ actual_line ].len > 0 ) {
-                actual_line++;
-            }
+    if ( !text->map ) {
+        text->buffer = ReadToBuffer( input_file );
+        text->text   = text->buffer;
+    }
 
-            strings[ actual_line ].ptr = buffer + 1;
-            strings[ actual_line ].len = 0;
+    return true;
+}
 
-            line++;
-        }
-        else {
-            strings[ actual_line ].len++;
+// Старший бит каждого нулевого байта слова, без ложных срабатываний в соседних байтах
+static uint64_t ZeroBytes( uint64_t word ) {
+    const uint64_t lows = 0x7F7F7F7F7F7F7F7Full;
+
+    return ~( ( ( word & lows ) + lows ) | word | lows );
+}
+
+// Первый '\n' или ';' в [ptr, end): по 8 байт за шаг ( SWAR ), байт равен c, если байт ( word ^ c ) нулевой
+static const char* FindLineEndOrComment( const char* ptr, const char* end ) {
+    const uint64_t ones = 0x0101010101010101ull;
+
+    while ( end - ptr >= ( ptrdiff_t ) sizeof( uint64_t ) ) {
+        uint64_t word = 0;
+        memcpy( &word, ptr, sizeof( word ) );
+
+        uint64_t found = ZeroBytes( word ^ ( ones * '\n' ) ) | ZeroBytes( word ^ ( ones * ';' ) );
+
+        if ( found ) {
+        #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return ptr + __builtin_ctzll( found ) / 8;
+        #else
+            return ptr + __builtin_clzll( found ) / 8;
+        #endif
         }
 
-        buffer++;
+        ptr += sizeof( uint64_t );
     }
 
-    if ( strings[ actual_line ].len == 0 && actual_line > 0 ) {
-        actual_line--;
-    }
+    while ( ptr < end && *ptr != '\n' && *ptr != ';' ) ptr++;
+
+    return ptr;
+}
+
+static void AddLine( TextFile_t* text, const char* ptr, size_t len ) {
+    if ( text->lines_count == text->lines_capacity ) {
+        size_t new_capacity = ( text->lines_capacity ) ? text->lines_capacity * 2 : 64;
+
+        StrPar* new_lines = ( StrPar* ) realloc ( text->lines, new_capacity * sizeof( *new_lines ) );
+        assert( new_lines && "Memory allocation error \n" );
 
-    PRINT( COLOR_BRIGHT_YELLOW "Out %s\n", __func__ )
+        text->lines          = new_lines;
+        text->lines_capacity = new_capacity;
+    }
 
-    return actual_line + 1;
+    text->lines[ text->lines_count ].ptr = ptr;
+    text->lines[ text->lines_count ].len = len;
+    text->lines_count++;
 }
 
-size_t RowCounter( const char* buffer ) {
-    my_assert( buffer, ASSERT_ERR_NULL_PTR );
+size_t IndexLines( TextFile_t* text ) {
+    my_assert( text, ASSERT_ERR_NULL_PTR );
+
+    PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ )
 
-    size_t cnt = 1;
+    text->lines_count = 0;
 
-    while ( *buffer != '\0' ) {
-        if ( *buffer == '\n' )  cnt++;
+    const char* ptr = text->text;
+    const char* end = text->text + text->size;
 
-        buffer++;
+    while ( ptr < end ) {
+        const char* stop     = FindLineEndOrComment( ptr, end );
+        const char* line_end = stop;
+
+        if ( stop < end && *stop == ';' ) {
+            line_end = ( const char* ) memchr( stop, '\n', ( size_t ) ( end - stop ) );
+            if ( !line_end ) line_end = end;
+        }
+
+        AddLine( text, ptr, ( size_t ) ( stop - ptr ) );
+
+        ptr = line_end + 1;
     }
 
-    return cnt;
+    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
+
+    return text->lines_count;
+}
+
+void UnmapTextFile( TextFile_t* text ) {
+    my_assert( text, ASSERT_ERR_NULL_PTR );
+
+    if ( text->map ) munmap( text->map, text->map_size );
+
+    free( text->buffer );
+    free( text->lines );
+
+    *text = {};
 }
 
 off_t DetermineFileSize( const char* file_address ) {
@@ -125,4 +261,67 @@ off_t DetermineFileSize( const char* file_address ) {
     my_assert( check_stat == 0, ASSERT_ERR_FAIL_STAT );
 
     return file_stat.st_size;
+}
+
+const int WRITE_PARTS_MAX = 8;
+
+static bool WriteAll( int fd, const struct iovec* parts, int parts_count ) {
+    struct iovec pending[ WRITE_PARTS_MAX ] = {};
+    memcpy( pending, parts, ( size_t ) parts_count * sizeof( *parts ) );
+
+    // writev может записать не все: дописывается остаток с места остановки
+    int first = 0;
+    while ( first < parts_count ) {
+        ssize_t result = writev( fd, pending + first, parts_count - first );
+        if ( result < 0 ) {
+            if ( errno == EINTR ) continue;
+            return false;
+        }
+
+        size_t written = ( size_t ) result;
+        while ( first < parts_count && written >= pending[ first ].iov_len ) {
+            written -= pending[ first ].iov_len;
+            first++;
+        }
+
+        if ( first < parts_count ) {
+            pending[ first ].iov_base = ( char* ) pending[ first ].iov_base + written;
+            pending[ first ].iov_len -= written;
+        }
+    }
+
+    return true;
+}
+
+bool WriteFileAtomic( const char* file_address, const struct iovec* parts, int parts_count ) {
+    my_assert( file_address, ASSERT_ERR_NULL_PTR );
+    my_assert( parts,        ASSERT_ERR_NULL_PTR );
+    assert( parts_count >= 0 && parts_count <= WRITE_PARTS_MAX && "Too many parts to write \n" );
+
+    size_t temp_size    = strlen( file_address ) + 32;
+    char*  temp_address = ( char* ) calloc ( temp_size, sizeof( *temp_address ) );
+    assert( temp_address && "Memory allocation error \n" );
+
+    // rename атомарен только в пределах одной файловой системы, поэтому временный файл - в том же каталоге
+    snprintf( temp_address, temp_size, "%s.%ld.tmp", file_address, ( long ) getpid() );
+
+    int fd = open( temp_address, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+    if ( fd < 0 ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Can not create file: %s \n" COLOR_RESET, temp_address );
+        free( temp_address );
+        return false;
+    }
+
+    bool written = WriteAll( fd, parts, parts_count );
+    written = ( close( fd ) == 0 ) && written;
+    written = written && ( rename( temp_address, file_address ) == 0 );
+
+    if ( !written ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Can not write file: %s \n" COLOR_RESET, file_address );
+        unlink( temp_address );
+    }
+
+    free( temp_address );
+
+    return written;
 }
\ No newline at end of file
@@ -1,67 +1,14 @@
 #include "assembler.h"
 
-#define StrCompare( str1, str2 ) strncmp( str1, str2, sizeof( str2 ) - 1 )
-#define FREE_BUF_AND_STRINGS free( buffer ); free( strings );
-
-const int SUCCESS_RESULT = 1;
-const int FAIL_RESULT = 0;
-const int NOT_REGISTER = -1;
-
 ON_DEBUG( void PrintLabels( Assembler_t* assembler ); )
 
-// =================================
-// Новые функции для меток
-// =================================
-
-int FindLabelAddress( const Assembler_t* assembler, const char* label_name ) {
-    my_assert( assembler,   ASSERT_ERR_NULL_PTR );
-    my_assert( label_name,  ASSERT_ERR_NULL_PTR );
-    
-    // Поиск по точному совпадению имени
-    for ( size_t i = 0; i < assembler->labels_count; i++ ) {
-        if ( strcmp( assembler->labels[i].name, label_name ) == 0 ) {
-            return assembler->labels[i].address;
-        }
-    }
-    
-    return -1;  // Метка не найдена
-}
-
-int AddLabel( Assembler_t* assembler, const char* label_name, int address ) {
-    my_assert( assembler,   ASSERT_ERR_NULL_PTR );
-    my_assert( label_name,  ASSERT_ERR_NULL_PTR );
-    
-    if ( assembler->labels_count >= LABELS_NUMBER ) {
-        fprintf( stderr, COLOR_BRIGHT_RED "Maximum number of labels (%lu) exceeded\n" COLOR_RESET, LABELS_NUMBER );
-        return FAIL_RESULT;
-    }
-    
-    // Проверяем, что метка еще не существует
-    if ( FindLabelAddress( assembler, label_name ) != -1 ) {
-        fprintf( stderr, COLOR_BRIGHT_RED "Label '%s' already defined\n" COLOR_RESET, label_name );
-        return FAIL_RESULT;
-    }
-    
-    strncpy( assembler->labels[assembler->labels_count].name, label_name, MAX_LABEL_LEN - 1 );
-    assembler->labels[assembler->labels_count].name[MAX_LABEL_LEN - 1] = '\0';
-    assembler->labels[assembler->labels_count].address = address;
-    assembler->labels_count++;
-    
-    return SUCCESS_RESULT;
-}
-
 void AssemblerCtor( Assembler_t* assembler, int argc, char** argv ) {
     my_assert( assembler,        ASSERT_ERR_NULL_PTR        );
     my_assert( argv,             ASSERT_ERR_NULL_PTR        );
 
-    ArgvProcessing( argc, argv, &( assembler->asm_file ), &( assembler->exe_file ) );
+    ArgvProcessing( argc, argv, &( assembler->asm_file ), &( assembler->exe_file ), &( assembler->options ) );
 
-    // Очищаем массив меток
-    for ( size_t i = 0; i < LABELS_NUMBER; i++ ) {
-        assembler->labels[i].name[0] = '\0';
-        assembler->labels[i].address = -1;
-    }
-    assembler->labels_count = 0;
+    LabelTableCtor( &( assembler->labels ) );
 }
 
 void AssemblerDtor( Assembler_t* assembler ) {
@@ -70,11 +17,22 @@ void AssemblerDtor( Assembler_t* assembler ) {
     free( assembler->byte_code );
     assembler->byte_code = NULL;
 
+    LabelTableDtor( &( assembler->labels ) );
+
+    free( assembler->fixups );
+    assembler->fixups = NULL;
+
     free( assembler->asm_file.address );
     assembler->asm_file.address = NULL;
 
     free( assembler->exe_file.address );
     assembler->exe_file.address = NULL;
+
+    free( assembler->options.cache_dir );
+    assembler->options.cache_dir = NULL;
+
+    free( assembler->cache_entry );
+    assembler->cache_entry = NULL;
 }
 
 int AsmCodeToByteCode( Assembler_t* assembler ) {
@@ -82,407 +40,369 @@ int AsmCodeToByteCode( Assembler_t* assembler ) {
 
     PRINT( GRID COLOR_BRIGHT_YELLOW "In %s \n\n", __func__ )
 
-    char* buffer = ReadToBuffer( &( assembler->asm_file ) );
-
-    StrPar* strings = ( StrPar* ) calloc ( assembler->asm_file.nLines, sizeof( *strings ) );
-    assert( strings && "Error in memory allocation for \"strings\" \n" );
-
-    assembler->asm_file.nLines = SplitIntoLines( strings, buffer, assembler->asm_file.nLines );
+    TextFile_t source = {};
+    if ( !MapTextFile( &( assembler->asm_file ), &source ) ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Can not open file: %s \n" COLOR_RESET, assembler->asm_file.address );
+        return FAIL_RESULT;
+    }
 
-    // Каждая строка может содержать максимум 2 инструкции
-    assembler->byte_code = ( int* ) calloc ( assembler->asm_file.nLines * 2, sizeof( int ) );
-    assert( assembler->byte_code && "Error in memory allocation for \"byte-code\" \n" );
+    assembler->asm_file.nLines = IndexLines( &source );
 
     int translate_result = 1;
 
-    PRINT( COLOR_BRIGHT_YELLOW "\n  ---First Run--- \n" );
-    translate_result = TranslateAsmToByteCode( assembler, strings );
-    ON_DEBUG( PrintLabels( assembler ); )
-    if ( translate_result == 0 ) { FREE_BUF_AND_STRINGS; return 0; }
-
-    PRINT( COLOR_BRIGHT_YELLOW "\n  ---Second Run---    \n");
-    translate_result = TranslateAsmToByteCode( assembler, strings );
+    // Один проход: ссылки вперед дописываются в ResolveFixups, пока исходник еще отображен
+    PRINT( COLOR_BRIGHT_YELLOW "\n  ---Single Run--- \n" );
+    translate_result = ( assembler->options.threads > 1 )
+                     ? TranslateAsmParallel  ( assembler, &source )
+                     : TranslateAsmToByteCode( assembler, source.text, source.size );
+    if ( translate_result == SUCCESS_RESULT ) {
+        translate_result = ResolveFixups( assembler );
+    }
+    if ( translate_result == SUCCESS_RESULT && assembler->options.optimize >= 1 ) {
+        OptimizeByteCode( assembler );
+    }
     ON_DEBUG( PrintLabels( assembler ); )
-    FREE_BUF_AND_STRINGS;
+    UnmapTextFile( &source );
 
     PRINT( "\n" GRID COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
 
     return translate_result;
 }
 
-int TranslateAsmToByteCode( Assembler_t* assembler, StrPar* strings ) {
+static const char* ExpectedOperand( const Opcode_t* opcode ) {
+    switch ( opcode->operand ) {
+        case OPERAND_NONE:     return ( opcode->other_form ) ? "no arguments or REGISTER" : "no arguments";
+        case OPERAND_NUMBER:   return ( opcode->other_form ) ? "NUMBER or REGISTER"       : "NUMBER";
+        case OPERAND_REGISTER: return "REGISTER";
+        case OPERAND_MEMORY:   return ( opcode->other_form ) ? "[REGISTER] or ADDRESS"    : "[REGISTER]";
+        case OPERAND_ADDRESS:  return "ADDRESS";
+        case OPERAND_LABEL:    return ":label";
+        default:               return "?";
+    }
+}
+
+void ReserveByteCode( Assembler_t* assembler, size_t words ) {
     my_assert( assembler, ASSERT_ERR_NULL_PTR );
-    my_assert( strings,   ASSERT_ERR_NULL_PTR );
 
-    assembler->instruction_cnt = 0;
+    if ( words <= assembler->code_capacity ) return;
 
-    char instruction[ MAX_INSTRUCT_LEN ] = "";
-    char label_name[ MAX_LABEL_LEN ] = "";
-    Argument argument = {};
+    size_t new_capacity = ( assembler->code_capacity ) ? assembler->code_capacity : 256;
+    while ( new_capacity < words ) new_capacity *= 2;
 
-    int command          = 0;
-    int number_of_params = 0;
-    int number_of_characters_read = 0;
-    const char* str_pointer = 0;
-    int HLT_flag = 0;
+    int* new_code = ( int* ) realloc ( assembler->byte_code, new_capacity * sizeof( *new_code ) );
+    assert( new_code && "Error in memory allocation for \"byte-code\" \n" );
 
-    for ( size_t i = 0; i < assembler->asm_file.nLines; i++ ) {
-        str_pointer = strings[i].ptr;
-        
-        // Пропускаем пустые строки и комментарии
-        if ( str_pointer[0] == ';' || str_pointer[0] == '\0' ) continue;
-        
-        number_of_params = sscanf( str_pointer, "%s%n", instruction, &number_of_characters_read );
-        if ( number_of_params == 0 ) continue;
-        
-        // Пропускаем, если первый токен - комментарий
-        if ( instruction[0] == ';' ) continue;
-
-        str_pointer += number_of_characters_read;
-        command = AsmCodeProcessing( instruction );
-        
-        // Обрезаем комментарии - ищем в (char*) версии
-        const char* comment_pos = strchr( str_pointer, ';' );
-        if ( comment_pos ) {
-            // Создаем локальную копию для обрезки
-            char temp_str[256] = "";
-            strncpy( temp_str, str_pointer, comment_pos - str_pointer );
-            temp_str[comment_pos - str_pointer] = '\0';
-            str_pointer = temp_str;  // Используем обрезанную версию
-        }
-        
-        ArgumentProcessing( &argument, str_pointer );
-
-        switch ( command ) {
-            case MARK_CMD: {
-                // Парсим название метки (:label_name или :0)
-                strncpy( label_name, instruction + 1, MAX_LABEL_LEN - 1 );
-                label_name[MAX_LABEL_LEN - 1] = '\0';
-                
-                // Добавляем метку
-                if ( AddLabel( assembler, label_name, (int)assembler->instruction_cnt ) == SUCCESS_RESULT ) {
-                    PRINT( COLOR_BRIGHT_GREEN "%-10s\n", strings[i].ptr );
-                } else {
-                    return FAIL_RESULT;
-                }
-                break;
-            }
+    assembler->byte_code     = new_code;
+    assembler->code_capacity = new_capacity;
+}
 
-            case PUSH_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
-
-                if ( argument.type == NUMBER ) {
-                    assembler->byte_code[ assembler->instruction_cnt++ ] = argument.value;
-                    PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d %d \n", strings[i].ptr, command, argument.value );
-                } else {
-                    fprintf( stderr, COLOR_BRIGHT_RED "Incorrect argument for PUSH in file: %s:%lu (expected NUMBER)\n", assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-                break;
-            }
+static inline void EmitWord( Assembler_t* assembler, int word ) {
+    if ( assembler->instruction_cnt == assembler->code_capacity ) {
+        ReserveByteCode( assembler, assembler->instruction_cnt + 1 );
+    }
 
-            case PUSHR_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
-
-                if ( argument.type == REGISTER ) {
-                    assembler->byte_code[ assembler->instruction_cnt++ ] = argument.value;
-                    PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d %d \n", strings[i].ptr, command, argument.value );
-                } else {
-                    fprintf( stderr, COLOR_BRIGHT_RED "Incorrect argument for PUSHR in file: %s:%lu (expected REGISTER)\n", assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-                break;
-            }
+    assembler->byte_code[ assembler->instruction_cnt++ ] = word;
+}
 
-            case POP_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
+// Подходит ли токен операнда виду операнда команды
+static bool OperandFits( OperandKind_t kind, const Token_t* operand ) {
+    switch ( kind ) {
+        case OPERAND_NONE:     return operand->type == TOKEN_END;
+        case OPERAND_NUMBER:   return operand->type == TOKEN_NUMBER;
+        case OPERAND_REGISTER: return operand->type == TOKEN_REGISTER;
+        case OPERAND_MEMORY:   return operand->type == TOKEN_MEMORY || operand->type == TOKEN_REGISTER;  // [RAX] или RAX
+        case OPERAND_ADDRESS:  return operand->type == TOKEN_NUMBER && operand->value >= 0;
+        case OPERAND_LABEL:    return operand->type == TOKEN_LABEL  && operand->len > 1;
+        default:               return false;
+    }
+}
 
-                if ( argument.type != VOID ) {
-                    fprintf( stderr, COLOR_BRIGHT_RED "Incorrect argument for POP in file: %s:%lu (expected no arguments)\n", assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-                PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d \n", strings[i].ptr, command );
-                break;
-            }
+// Лексер знает регистры RAX..RZX, у процессора их REGS_NUMBER: лишние отвергаются здесь, а не при загрузке
+static int CheckRegister( const Assembler_t* assembler, const Token_t* operand ) {
+    if ( ( operand->type != TOKEN_REGISTER && operand->type != TOKEN_MEMORY ) || operand->value < REGS_NUMBER ) {
+        return SUCCESS_RESULT;
+    }
 
-            case POPR_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
-
-                if ( argument.type == REGISTER ) {
-                    assembler->byte_code[ assembler->instruction_cnt++ ] = argument.value;
-                    PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d %d \n", strings[i].ptr, command, argument.value );
-                } else {
-                    fprintf( stderr, COLOR_BRIGHT_RED "Incorrect argument for POPR in file: %s:%lu (expected REGISTER)\n", assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-                break;
-            }
+    fprintf( stderr, COLOR_BRIGHT_RED "Register %.*s is out of range ( RAX..R%cX ) in file: %s:%lu:%lu \n",
+             ( int ) operand->len, operand->ptr, 'A' + REGS_NUMBER - 2, assembler->asm_file.address,
+             operand->line, operand->column );
 
-            case PUSHM_CMD:
-            case POPM_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
-
-                if ( argument.type == REGISTER ) {
-                    assembler->byte_code[ assembler->instruction_cnt++ ] = argument.value;
-                    PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d %d (via register)\n", strings[i].ptr, command, argument.value );
-                } else if ( argument.type == NUMBER ) {
-                    assembler->byte_code[ assembler->instruction_cnt++ ] = argument.value + 100;
-                    PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d %d (direct address)\n", strings[i].ptr, command, argument.value + 100 );
-                } else {
-                    fprintf( stderr, COLOR_BRIGHT_RED "Incorrect argument for %s in file: %s:%lu (expected [REGISTER] or NUMBER)\n", 
-                             (command == PUSHM_CMD) ? "PUSHM" : "POPM", assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-                break;
-            }
+    return FAIL_RESULT;
+}
 
-            case ADD_CMD:
-            case SUB_CMD:
-            case MUL_CMD:
-            case DIV_CMD:
-            case POW_CMD:
-            case SQRT_CMD:
-            case IN_CMD:
-            case OUT_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
-
-                if ( argument.type != VOID ) {
-                    fprintf( stderr, COLOR_BRIGHT_RED "Incorrect command in file: %s:%lu \n", assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-
-                PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d \n", strings[i].ptr, command );
-                break;
-            }
+// Команда и ее операнд по виду операнда из OPCODES; source - начало строки для сообщений о метках
+static int EncodeInstruction( Assembler_t* assembler, const Opcode_t* opcode, const Token_t* operand, const char* source ) {
+    if ( !OperandFits( opcode->operand, operand ) ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Incorrect argument for %s in file: %s:%lu:%lu (expected %s)\n",
+                 opcode->name, assembler->asm_file.address, operand->line, operand->column, ExpectedOperand( opcode ) );
+        return FAIL_RESULT;
+    }
 
-            case JMP_CMD:
-            case JE_CMD:
-            case JB_CMD:
-            case JA_CMD:
-            case JBE_CMD:
-            case JAE_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
-
-                // Парсим название метки - может быть :0, :1, :label_name и т.д.
-                char target_label[MAX_LABEL_LEN] = "";
-                int parsed = sscanf( str_pointer, ":%s", target_label );
-                
-                // Обрезаем пробелы и комментарии
-                for ( int j = 0; j < (int)strlen(target_label); j++ ) {
-                    if ( isspace(target_label[j]) || target_label[j] == ';' ) {
-                        target_label[j] = '\0';
-                        break;
-                    }
-                }
-                
-                if ( parsed != 1 || strlen(target_label) == 0 ) {
-                    fprintf( stderr, COLOR_BRIGHT_RED "No label specified for %s in file: %s:%lu\n", 
-                             (command == JMP_CMD) ? "JMP" : "conditional jump", assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-                
-                int target_address = FindLabelAddress( assembler, target_label );
-                if ( target_address != -1 ) {
-                    assembler->byte_code[ assembler->instruction_cnt++ ] = target_address;
-                    PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d %d \n", strings[i].ptr, assembler->byte_code[ assembler->instruction_cnt - 2 ],
-                                                                                      assembler->byte_code[ assembler->instruction_cnt - 1 ] );
-                } else {
-                    fprintf( stderr, COLOR_BRIGHT_RED "Label '%s' not found in file: %s:%lu\n", target_label, assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-                break;
-            }
+    if ( CheckRegister( assembler, operand ) != SUCCESS_RESULT ) return FAIL_RESULT;
 
-            case CALL_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
-
-                // Парсим название метки для CALL
-                char func_label[MAX_LABEL_LEN] = "";
-                int parsed_call = sscanf( str_pointer, ":%s", func_label );
-                
-                // Обрезаем пробелы и комментарии
-                for ( int j = 0; j < (int)strlen(func_label); j++ ) {
-                    if ( isspace(func_label[j]) || func_label[j] == ';' ) {
-                        func_label[j] = '\0';
-                        break;
-                    }
-                }
-                
-                if ( parsed_call != 1 || strlen(func_label) == 0 ) {
-                    fprintf( stderr, COLOR_BRIGHT_RED "No function label specified for CALL in file: %s:%lu\n", assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-                
-                int func_address = FindLabelAddress( assembler, func_label );
-                if ( func_address != -1 ) {
-                    assembler->byte_code[ assembler->instruction_cnt++ ] = func_address;
-                    PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d %d \n", strings[i].ptr, assembler->byte_code[ assembler->instruction_cnt - 2],
-                                                                                      assembler->byte_code[ assembler->instruction_cnt - 1 ] );
-                } else {
-                    fprintf( stderr, COLOR_BRIGHT_RED "Function '%s' not found in file: %s:%lu\n", func_label, assembler->asm_file.address, i + 1 );
-                    return FAIL_RESULT;
-                }
-                break;
-            }
+    EmitWord( assembler, opcode->code );
+
+    switch ( opcode->operand ) {
+        case OPERAND_NONE:
+            break;
 
-            case RET_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
+        // Название метки - может быть :0, :1, :label_name и т.д.
+        case OPERAND_LABEL: {
+            const char* label  = operand->ptr + 1;
+            size_t      length = operand->len - 1;
 
-                PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d \n", strings[i].ptr, assembler->byte_code[ assembler->instruction_cnt - 1 ] );
-                break;
+            // Метка еще не объявлена или адрес внутри части файла неокончательный - адрес допишет ResolveFixups
+            int address = ( assembler->defer_labels ) ? -1 : FindLabelAddress( assembler, label, length );
+            if ( address == -1 ) {
+                AddFixup( assembler, label, length, assembler->instruction_cnt, operand->line, source, opcode->code );
             }
 
-            case HLT_CMD: {
-                assembler->byte_code[ assembler->instruction_cnt++ ] = command;
-                HLT_flag++;
+            EmitWord( assembler, address );
+            break;
+        }
 
-                PRINT( COLOR_BRIGHT_GREEN "%-10s --- %-2d \n", strings[i].ptr, assembler->byte_code[ assembler->instruction_cnt - 1 ] );
-                break;
-            }
+        // Номер регистра и у [RAX]
+        case OPERAND_NUMBER:
+        case OPERAND_REGISTER:
+        case OPERAND_MEMORY:
+        case OPERAND_ADDRESS:
+        default:
+            EmitWord( assembler, operand->value );
+            break;
+    }
 
-            default: {
-                fprintf( stderr, COLOR_BRIGHT_RED "Incorrect command \"%s\" in file: %s:%lu \n", strings[i].ptr, assembler->asm_file.address, i + 1 );
+    return SUCCESS_RESULT;
+}
+
+static int UnexpectedToken( const Assembler_t* assembler, const Token_t* token ) {
+    fprintf( stderr, COLOR_BRIGHT_RED "Unexpected \"%.*s\" in file: %s:%lu:%lu \n",
+             ( int ) token->len, token->ptr, assembler->asm_file.address, token->line, token->column );
+
+    return FAIL_RESULT;
+}
+
+// Команда с операндами со стека ( ListOperands ): без операндов - одно слово команды,
+// с операндами в строке - сначала PUSH числа, PUSHR регистра или PUSHM [регистра] для каждого
+static int EncodeOperandList( Assembler_t* assembler, const Opcode_t* opcode, Lexer_t* lexer, const Token_t* command ) {
+    size_t  expected = ListOperands( opcode->code );
+    Token_t operands[ MAX_LIST_OPERANDS + 1 ] = {};
+    size_t  count = 0;
+
+    while ( count <= expected && LexToken( lexer, operands + count ) ) count++;
+
+    if ( count > expected ) return UnexpectedToken( assembler, operands + expected );
+
+    if ( count != 0 && count != expected ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Incorrect arguments for %s in file: %s:%lu:%lu (expected no arguments or %lu)\n",
+                 opcode->name, assembler->asm_file.address, command->line, command->column, expected );
+        return FAIL_RESULT;
+    }
+
+    for ( size_t i = 0; i < count; i++ ) {
+        const Token_t* operand = operands + i;
+
+        int push = 0;
+        switch ( operand->type ) {
+            case TOKEN_NUMBER:   push = PUSH_CMD;  break;
+            case TOKEN_REGISTER: push = PUSHR_CMD; break;
+            case TOKEN_MEMORY:   push = PUSHM_CMD; break;
+            case TOKEN_END:
+            case TOKEN_WORD:
+            case TOKEN_LABEL:
+            default:
+                fprintf( stderr, COLOR_BRIGHT_RED "Incorrect argument for %s in file: %s:%lu:%lu (expected NUMBER, REGISTER or [REGISTER])\n",
+                         opcode->name, assembler->asm_file.address, operand->line, operand->column );
                 return FAIL_RESULT;
-            }
         }
+
+        if ( CheckRegister( assembler, operand ) != SUCCESS_RESULT ) return FAIL_RESULT;
+
+        EmitWord( assembler, push );
+        EmitWord( assembler, operand->value );
     }
 
-    if ( HLT_flag ) return SUCCESS_RESULT;
+    EmitWord( assembler, opcode->code );
+
+    return SUCCESS_RESULT;
+}
+
+int TranslateLines( Assembler_t* assembler, Lexer_t* lexer, bool* has_hlt ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
+    my_assert( lexer,     ASSERT_ERR_NULL_PTR );
+    my_assert( has_hlt,   ASSERT_ERR_NULL_PTR );
+
+    assembler->instruction_cnt = 0;
+
+    Token_t token   = {};
+    Token_t operand = {};
+    Token_t extra   = {};
+
+    do {
+        // Пропускаем пустые строки и комментарии
+        if ( !LexToken( lexer, &token ) ) continue;
+
+        const char* source = lexer->line_start;
+
+        if ( token.type == TOKEN_LABEL ) {
+            // Название метки (:label_name или :0) берется прямо из буфера
+            if ( AddLabel( assembler, token.ptr + 1, token.len - 1, (int)assembler->instruction_cnt ) != SUCCESS_RESULT ) {
+                fprintf( stderr, COLOR_BRIGHT_RED "  in file: %s:%lu:%lu \n", assembler->asm_file.address, token.line, token.column );
+                return FAIL_RESULT;
+            }
+
+            if ( LexToken( lexer, &extra ) ) return UnexpectedToken( assembler, &extra );
+
+            PRINT( COLOR_BRIGHT_GREEN "%.*s\n", ( int ) token.len, token.ptr );
+            continue;
+        }
+
+        // Мнемоника сравнивается целиком: PUSHX или HLTZ - неизвестные команды
+        const Opcode_t* opcode = ( token.type == TOKEN_WORD ) ? FindOpcode( token.ptr, token.len ) : NULL;
+        if ( !opcode ) {
+            fprintf( stderr, COLOR_BRIGHT_RED "Incorrect command \"%.*s\" in file: %s:%lu:%lu \n",
+                     ( int ) token.len, token.ptr, assembler->asm_file.address, token.line, token.column );
+            return FAIL_RESULT;
+        }
+
+        if ( ListOperands( opcode->code ) > 0 ) {
+            if ( EncodeOperandList( assembler, opcode, lexer, &token ) != SUCCESS_RESULT ) return FAIL_RESULT;
+            continue;
+        }
+
+        // Операнда может не быть - тогда operand.type == TOKEN_END
+        if ( LexToken( lexer, &operand ) && LexToken( lexer, &extra ) ) {
+            return UnexpectedToken( assembler, &extra );
+        }
+
+        // PUSH RAX, POP RAX - краткие формы PUSHR RAX, POPR RAX; PUSHM 5, POPM 5 - PUSHMA 5, POPMA 5
+        if ( opcode->other_form != 0 && !OperandFits( opcode->operand, &operand ) &&
+             OperandFits( FindOpcodeByCode( opcode->other_form )->operand, &operand ) ) {
+            opcode = FindOpcodeByCode( opcode->other_form );
+        }
+
+        if ( EncodeInstruction( assembler, opcode, &operand, source ) != SUCCESS_RESULT ) {
+            return FAIL_RESULT;
+        }
+
+        if ( opcode->code == HLT_CMD ) *has_hlt = true;
+
+        PRINT( COLOR_BRIGHT_GREEN "%-10.*s --- %-2d %d \n", ( int ) token.len, token.ptr, opcode->code,
+               ( opcode->size > 1 ) ? assembler->byte_code[ assembler->instruction_cnt - 1 ] : 0 );
+    } while ( LexNextLine( lexer ) );
+
+    return SUCCESS_RESULT;
+}
+
+int TranslateAsmToByteCode( Assembler_t* assembler, const char* buffer, size_t size ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
+    my_assert( buffer,    ASSERT_ERR_NULL_PTR );
+
+    Lexer_t lexer   = {};
+    bool    has_hlt = false;
+
+    LexerCtor( &lexer, buffer, size );
+
+    if ( TranslateLines( assembler, &lexer, &has_hlt ) != SUCCESS_RESULT ) return FAIL_RESULT;
+
+    if ( has_hlt ) return SUCCESS_RESULT;
 
     fprintf( stderr, COLOR_BRIGHT_RED "There is no HLT command \n" COLOR_RESET );
     return FAIL_RESULT;
 }
 
-int AsmCodeProcessing( char* instruction ) {
-    my_assert( instruction, ASSERT_ERR_NULL_PTR );
-
-    if ( instruction[0] == ':' )                    { return MARK_CMD; }
-    
-    if ( StrCompare( instruction, "PUSHM" ) == 0 ) { return PUSHM_CMD; }
-    if ( StrCompare( instruction, "PUSHR" ) == 0 ) { return PUSHR_CMD; }
-    if ( StrCompare( instruction, "PUSH" ) == 0 )  { return PUSH_CMD; }
-    if ( StrCompare( instruction, "POPM" ) == 0 )  { return POPM_CMD; }
-    if ( StrCompare( instruction, "POPR" ) == 0 )  { return POPR_CMD;  }
-    if ( StrCompare( instruction, "POP"  ) == 0 )  { return POP_CMD;  }
-    if ( StrCompare( instruction, "ADD"  ) == 0 )  { return ADD_CMD;  }
-    if ( StrCompare( instruction, "SUB"  ) == 0 )  { return SUB_CMD;  }
-    if ( StrCompare( instruction, "MUL"  ) == 0 )  { return MUL_CMD;  }
-    if ( StrCompare( instruction, "DIV"  ) == 0 )  { return DIV_CMD;  }
-    if ( StrCompare( instruction, "POW"  ) == 0 )  { return POW_CMD;  }
-    if ( StrCompare( instruction, "SQRT" ) == 0 )  { return SQRT_CMD; }
-    if ( StrCompare( instruction, "IN"   ) == 0 )  { return IN_CMD;   }
-    if ( StrCompare( instruction, "OUT"  ) == 0 )  { return OUT_CMD;  }
-    if ( StrCompare( instruction, "CALL" ) == 0 )  { return CALL_CMD; }
-    if ( StrCompare( instruction, "RET"  ) == 0 )  { return RET_CMD;  }
-
-    if ( StrCompare( instruction, "JMP"  ) == 0 )  { return JMP_CMD;  }
-    if ( StrCompare( instruction, "JE"   ) == 0 )  { return JE_CMD;   }
-    if ( StrCompare( instruction, "JB"   ) == 0 )  { return JB_CMD;   }
-    if ( StrCompare( instruction, "JA"   ) == 0 )  { return JA_CMD;   }
-    if ( StrCompare( instruction, "JBE"  ) == 0 )  { return JBE_CMD;  }
-    if ( StrCompare( instruction, "JAE"  ) == 0 )  { return JAE_CMD;  }
-
-    if ( StrCompare( instruction, "HLT"  ) == 0 )  { return HLT_CMD;  }
+// Десятичная запись value с конца буфера: возвращает начало записи
+static char* FormatInt( char* end, long long value ) {
+    unsigned long long magnitude = ( value < 0 ) ? 0ull - ( unsigned long long ) value : ( unsigned long long ) value;
 
-    return FAIL_RESULT;
+    do {
+        *--end = ( char ) ( '0' + magnitude % 10 );
+        magnitude /= 10;
+    } while ( magnitude > 0 );
+
+    if ( value < 0 ) *--end = '-';
+
+    return end;
 }
 
-void OutputInFile( Assembler_t* assembler ) {
+int OutputInFile( Assembler_t* assembler ) {
     my_assert( assembler, ASSERT_ERR_NULL_PTR );
 
-    FILE* file = fopen( assembler->exe_file.address, "w" );
-    my_assert( file, ASSERT_ERR_FAIL_OPEN );
+    const size_t number_size = 24;  // Хватает на знак и цифры long long
+
+    // "count v v v ...": каждое значение - пробел и не больше 11 символов int
+    char* text = ( char* ) calloc ( number_size + assembler->instruction_cnt * 12, sizeof( *text ) );
+    assert( text && "Error in memory allocation for text byte code \n" );
 
-    fprintf( file, "%lu", assembler->instruction_cnt );
+    char   number[ number_size ] = {};
+    char*  digits = FormatInt( number + number_size, ( long long ) assembler->instruction_cnt );
+    size_t length = ( size_t ) ( number + number_size - digits );
+
+    memcpy( text, digits, length );
 
     for ( size_t i = 0; i < assembler->instruction_cnt; i++ ) {
-        fprintf( file, " %d", assembler->byte_code[i] );
+        text[ length++ ] = ' ';
+
+        digits = FormatInt( number + number_size, assembler->byte_code[i] );
+        memcpy( text + length, digits, ( size_t ) ( number + number_size - digits ) );
+        length += ( size_t ) ( number + number_size - digits );
     }
 
-    int result_of_fclose = fclose( file );
-    my_assert( result_of_fclose == 0, ASSERT_ERR_FAIL_CLOSE )
-}
+    struct iovec part = { text, length };
+    bool written = WriteFileAtomic( assembler->exe_file.address, &part, 1 );
 
-int ArgumentProcessing( Argument* argument, const char* string ) {
-    my_assert( string,   ASSERT_ERR_NULL_PTR );
-    my_assert( argument, ASSERT_ERR_NULL_PTR );
+    free( text );
 
-    int number_of_elements_read = 0;
-    argument->type = VOID;
-    argument->value = -1;
+    return ( written ) ? SUCCESS_RESULT : FAIL_RESULT;
+}
 
-    while ( *string && isspace( *string ) ) string++;
-    
-    if ( !*string || *string == ';' ) {
-        argument->type = VOID;
-        return -1;
+static void PutLittleEndian( uint8_t* out, uint32_t word ) {
+    for ( int i = 0; i < 4; i++, word >>= 8 ) {
+        out[i] = ( uint8_t ) ( word & 0xFF );
     }
+}
 
-    number_of_elements_read = sscanf( string, "%d", &( argument->value ) );
-    if ( number_of_elements_read == 1 ) {
-        argument->type = NUMBER;
-        return argument->value;
-    }
+int OutputInBinaryFile( Assembler_t* assembler ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
 
-    char instruction[MAX_LABEL_LEN] = "";
-    number_of_elements_read = sscanf( string, "%s", instruction );
-    if ( number_of_elements_read == 1 ) {
-        // Проверяем метки с двоеточием (:label_name или :0)
-        if ( instruction[0] == ':' ) {
-            // Метка обнаружена, но адрес будет заполнен позже
-            // Во втором проходе
-            argument->type = LABEL;
-            argument->value = 0;  // Временно, значение будет заменено
-            return 0;
-        }
+    ExeHeader_t header = {};
+    header.code_offset = ( uint32_t ) sizeof( header );
+    header.code_size   = ( uint32_t ) assembler->instruction_cnt;
 
-        if ( instruction[0] == '[' && instruction[strlen(instruction)-1] == ']' ) {
-            char reg[MAX_LABEL_LEN] = "";
-            strncpy( reg, instruction + 1, strlen(instruction) - 2 );
-            reg[strlen(instruction) - 2] = '\0';
-            
-            if ( strlen( reg ) == 3 && reg[0] == 'R' && reg[2] == 'X' ) {
-                argument->value = reg[1] - 'A' + 1;
-                if ( argument->value >= 1 && argument->value <= 26 ) {
-                    argument->type = REGISTER;
-                    return argument->value;
-                }
-            }
-            
-            if ( strlen( reg ) == 2 && reg[1] == 'X' && isalpha( reg[0] ) ) {
-                argument->value = reg[0] - 'A' + 1;
-                if ( argument->value >= 1 && argument->value <= 26 ) {
-                    argument->type = REGISTER;
-                    return argument->value;
-                }
-            }
-        }
+    const size_t header_size = sizeof( header ) / sizeof( uint32_t );
+    uint32_t header_words[ header_size ] = {};
+    memcpy( header_words, &header, sizeof( header ) );
 
-        if ( strlen( instruction ) == 3 && instruction[0] == 'R' && instruction[2] == 'X' ) {
-            argument->value = instruction[1] - 'A' + 1;
-            if ( argument->value >= 1 && argument->value <= 26 ) {
-                argument->type = REGISTER;
-                return argument->value;
-            }
-        }
-        
-        if ( strlen( instruction ) == 2 && instruction[1] == 'X' && isalpha( instruction[0] ) ) {
-            argument->value = instruction[0] - 'A' + 1;
-            if ( argument->value >= 1 && argument->value <= 26 ) {
-                argument->type = REGISTER;
-                return argument->value;
-            }
-        }
+    uint8_t header_image[ sizeof( header ) ] = {};
+    for ( size_t i = 0; i < header_size; i++ ) {
+        PutLittleEndian( header_image + i * sizeof( uint32_t ), header_words[i] );
     }
-    else {
-        argument->type = VOID;
-        return -1;
+
+    size_t code_bytes = assembler->instruction_cnt * sizeof( uint32_t );
+
+    // Заголовок и код - две части одного writev; на little-endian слова кода пишутся прямо из byte_code
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    void* code_image = assembler->byte_code;
+#else
+    uint8_t* code_image = ( uint8_t* ) calloc ( code_bytes + 1, 1 );
+    assert( code_image && "Error in memory allocation for executable image \n" );
+
+    for ( size_t i = 0; i < assembler->instruction_cnt; i++ ) {
+        PutLittleEndian( code_image + i * sizeof( uint32_t ), ( uint32_t ) assembler->byte_code[i] );
     }
+#endif
+
+    struct iovec parts[] = {
+        { header_image, sizeof( header_image ) },
+        { code_image,   code_bytes             }
+    };
 
-    PRINT( "%s\n", instruction );
-    argument->type = UNKNOWN;
-    argument->value = -1;
-    return -1;
+    bool written = WriteFileAtomic( assembler->exe_file.address, parts, ( code_bytes > 0 ) ? 2 : 1 );
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    free( code_image );
+#endif
+
+    return ( written ) ? SUCCESS_RESULT : FAIL_RESULT;
 }
 
 #ifdef _DEBUG
@@ -490,8 +410,11 @@ void PrintLabels( Assembler_t* assembler ) {
     my_assert( assembler, ASSERT_ERR_NULL_PTR );
 
     PRINT( COLOR_BLUE "Labels: \n" );
-    for ( size_t i = 0; i < assembler->labels_count; i++ ) {
-        PRINT( COLOR_BRIGHT_CYAN "%-32s - %d \n", assembler->labels[i].name, assembler->labels[i].address );
+    for ( size_t i = 0; i < assembler->labels.capacity; i++ ) {
+        const Label_t* label = assembler->labels.slots + i;
+        if ( !label->name ) continue;
+
+        PRINT( COLOR_BRIGHT_CYAN "%-32s - %d \n", label->name, label->address );
     }
 }
 #endif
@@ -0,0 +1,327 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/file.h>
+
+#include "assembler.h"
+
+// Кэш результатов ( -c dir ): выход лежит в dir/<ключ>.out, ключ - 128-битный FNV-1a от версии
+// ассемблера, параметров вывода и текста исходника. Если запись с ключом есть, исходник не ассемблируется,
+// а выход связывается с записью жесткой ссылкой ( на другой файловой системе - копируется ).
+// Время изменения записи - время последнего использования: сверх лимита удаляются самые давние ( LRU ).
+// Счетчики попаданий и промахов общие для всех запусков и хранятся в dir/stats под блокировкой dir/lock.
+
+// Каждая сборка ассемблера получает новый ключ, так что кэш прежней версии не используется
+static const char ASM_CACHE_VERSION[] = "asm-cache 1, built " __DATE__ " " __TIME__;
+
+static const char   CACHE_ENTRY_SUFFIX[] = ".out";
+static const size_t CACHE_KEY_LENGTH     = 32;  // 128 бит в шестнадцатеричной записи
+static const double MEGABYTE             = 1024.0 * 1024.0;
+
+typedef unsigned __int128 CacheHash_t;
+
+struct CacheStats_t {
+    size_t hits      = 0;
+    size_t misses    = 0;
+    size_t evictions = 0;
+    size_t entries   = 0;  // Число и размер записей после последнего просмотра каталога
+    size_t size      = 0;
+};
+
+struct CacheEntry_t {
+    char*    name = NULL;
+    size_t   size = 0;
+    timespec used = {};
+};
+
+static CacheHash_t HashBytes( CacheHash_t hash, const void* data, size_t size ) {
+    const CacheHash_t prime = ( ( CacheHash_t ) 1 << 88 ) + 0x13B;
+    const uint8_t*    bytes = ( const uint8_t* ) data;
+
+    for ( size_t i = 0; i < size; i++ ) {
+        hash ^= bytes[i];
+        hash *= prime;
+    }
+
+    return hash;
+}
+
+// Длина перед каждым полем: ключ однозначен при любых границах полей
+static CacheHash_t HashField( CacheHash_t hash, const void* data, size_t size ) {
+    hash = HashBytes( hash, &size, sizeof( size ) );
+
+    return HashBytes( hash, data, size );
+}
+
+static char* CachePath( const char* directory, const char* name ) {
+    size_t path_size = strlen( directory ) + strlen( name ) + 2;
+
+    char* path = ( char* ) calloc ( path_size, sizeof( *path ) );
+    assert( path && "Memory allocation error \n" );
+
+    snprintf( path, path_size, "%s/%s", directory, name );
+
+    return path;
+}
+
+static char* CacheEntryPath( const Assembler_t* assembler, const TextFile_t* source ) {
+    CacheHash_t hash = ( ( CacheHash_t ) 0x6C62272E07BB0142ull << 64 ) | 0x62B821756295C58Dull;
+
+    const Options_t* options = &( assembler->options );
+
+    hash = HashField( hash, ASM_CACHE_VERSION, sizeof( ASM_CACHE_VERSION ) );
+    hash = HashField( hash, &( options->format ), sizeof( options->format ) );
+    hash = HashField( hash, &( options->optimize ), sizeof( options->optimize ) );
+
+    // Программа на C называет исходный файл в комментарии
+    if ( options->format == OUTPUT_C ) {
+        hash = HashField( hash, assembler->asm_file.address, strlen( assembler->asm_file.address ) );
+    }
+
+    hash = HashField( hash, source->text, source->size );
+
+    char name[ CACHE_KEY_LENGTH + sizeof( CACHE_ENTRY_SUFFIX ) ] = {};
+    snprintf( name, sizeof( name ), "%016llx%016llx%s", ( unsigned long long ) ( hash >> 64 ),
+              ( unsigned long long ) hash, CACHE_ENTRY_SUFFIX );
+
+    return CachePath( options->cache_dir, name );
+}
+
+// to появляется атомарно: жесткая ссылка на from или копия, затем rename
+static bool LinkOrCopy( const char* from, const char* to ) {
+    size_t temp_size    = strlen( to ) + 32;
+    char*  temp_address = ( char* ) calloc ( temp_size, sizeof( *temp_address ) );
+    assert( temp_address && "Memory allocation error \n" );
+
+    snprintf( temp_address, temp_size, "%s.%ld.tmp", to, ( long ) getpid() );
+    unlink( temp_address );
+
+    bool done = false;
+
+    if ( link( from, temp_address ) == 0 ) {
+        done = ( rename( temp_address, to ) == 0 );
+        if ( !done ) unlink( temp_address );
+    }
+    else if ( errno != ENOENT ) {
+        FileStat   file = {};
+        TextFile_t data = {};
+
+        file.address = strdup( from );
+        if ( MapTextFile( &file, &data ) ) {
+            struct iovec part = { const_cast<char*>( data.text ), data.size };
+            done = WriteFileAtomic( to, &part, 1 );
+        }
+
+        UnmapTextFile( &data );
+        free( file.address );
+    }
+
+    free( temp_address );
+
+    return done;
+}
+
+// Блокировка каталога кэша на время изменения счетчиков и вытеснения; -1 - без блокировки
+static int LockCache( const char* directory ) {
+    char* lock_path = CachePath( directory, "lock" );
+
+    int fd = open( lock_path, O_RDWR | O_CREAT, 0666 );
+    if ( fd >= 0 && flock( fd, LOCK_EX ) != 0 ) {
+        close( fd );
+        fd = -1;
+    }
+
+    free( lock_path );
+
+    return fd;
+}
+
+static void UnlockCache( int fd ) {
+    if ( fd >= 0 ) close( fd );
+}
+
+static void ReadStats( const char* directory, CacheStats_t* stats ) {
+    char* stats_path = CachePath( directory, "stats" );
+
+    FILE* file = fopen( stats_path, "r" );
+    if ( file ) {
+        if ( fscanf( file, "hits %lu misses %lu evictions %lu", &( stats->hits ), &( stats->misses ), &( stats->evictions ) ) != 3 ) {
+            *stats = {};
+        }
+
+        fclose( file );
+    }
+
+    free( stats_path );
+}
+
+static void WriteStats( const char* directory, const CacheStats_t* stats ) {
+    char* stats_path = CachePath( directory, "stats" );
+
+    char text[ 128 ] = {};
+    int  length = snprintf( text, sizeof( text ), "hits %lu\nmisses %lu\nevictions %lu\n",
+                            stats->hits, stats->misses, stats->evictions );
+
+    struct iovec part = { text, ( size_t ) length };
+    WriteFileAtomic( stats_path, &part, 1 );
+
+    free( stats_path );
+}
+
+static bool IsCacheEntry( const char* name ) {
+    size_t length = strlen( name );
+
+    return length == CACHE_KEY_LENGTH + sizeof( CACHE_ENTRY_SUFFIX ) - 1
+        && strcmp( name + CACHE_KEY_LENGTH, CACHE_ENTRY_SUFFIX ) == 0;
+}
+
+static int CompareEntries( const void* first, const void* second ) {
+    const timespec* a = &( ( const CacheEntry_t* ) first  )->used;
+    const timespec* b = &( ( const CacheEntry_t* ) second )->used;
+
+    if ( a->tv_sec  != b->tv_sec  ) return ( a->tv_sec  < b->tv_sec  ) ? -1 : 1;
+    if ( a->tv_nsec != b->tv_nsec ) return ( a->tv_nsec < b->tv_nsec ) ? -1 : 1;
+
+    return 0;
+}
+
+// Подсчет записей и, если limit не 0, удаление самых давно использованных, пока размер больше limit
+static void ScanEntries( const char* directory, size_t limit, CacheStats_t* stats ) {
+    DIR* dir = opendir( directory );
+    if ( !dir ) return;
+
+    CacheEntry_t* entries  = NULL;
+    size_t        count    = 0;
+    size_t        capacity = 0;
+    size_t        total    = 0;
+
+    for ( dirent* item = readdir( dir ); item; item = readdir( dir ) ) {
+        if ( !IsCacheEntry( item->d_name ) ) continue;
+
+        char* path = CachePath( directory, item->d_name );
+
+        struct stat entry_stat = {};
+        if ( stat( path, &entry_stat ) == 0 ) {
+            if ( count == capacity ) {
+                capacity = ( capacity ) ? capacity * 2 : 64;
+                entries  = ( CacheEntry_t* ) realloc ( entries, capacity * sizeof( *entries ) );
+                assert( entries && "Memory allocation error \n" );
+            }
+
+            entries[ count ].name = path;
+            entries[ count ].size = ( size_t ) entry_stat.st_size;
+            entries[ count ].used = entry_stat.st_mtim;
+            count++;
+
+            total += ( size_t ) entry_stat.st_size;
+            path   = NULL;
+        }
+
+        free( path );
+    }
+
+    closedir( dir );
+
+    size_t evicted = 0;
+
+    if ( limit > 0 && total > limit ) {
+        qsort( entries, count, sizeof( *entries ), CompareEntries );
+
+        for ( size_t i = 0; i < count && total > limit; i++ ) {
+            if ( unlink( entries[i].name ) != 0 ) continue;
+
+            total -= entries[i].size;
+            evicted++;
+        }
+    }
+
+    for ( size_t i = 0; i < count; i++ ) {
+        free( entries[i].name );
+    }
+
+    stats->evictions += evicted;
+    stats->entries    = count - evicted;
+    stats->size = total;
+
+    free( entries );
+}
+
+bool CacheLookup( Assembler_t* assembler ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
+
+    const char* directory = assembler->options.cache_dir;
+    if ( !directory ) return false;
+
+    if ( mkdir( directory, 0777 ) != 0 && errno != EEXIST ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Can not create cache directory: %s \n" COLOR_RESET, directory );
+        return false;
+    }
+
+    // Нечитаемый исходник - промах, об ошибке сообщит ассемблирование
+    TextFile_t source = {};
+    if ( !MapTextFile( &( assembler->asm_file ), &source ) ) return false;
+
+    assembler->cache_entry = CacheEntryPath( assembler, &source );
+    UnmapTextFile( &source );
+
+    assembler->cache_hit = LinkOrCopy( assembler->cache_entry, assembler->exe_file.address );
+
+    // Время изменения записи - время последнего использования
+    if ( assembler->cache_hit ) utimensat( AT_FDCWD, assembler->cache_entry, NULL, 0 );
+
+    int lock = LockCache( directory );
+
+    CacheStats_t stats = {};
+    ReadStats( directory, &stats );
+    if ( assembler->cache_hit ) stats.hits++;
+    else                        stats.misses++;
+    WriteStats( directory, &stats );
+
+    UnlockCache( lock );
+
+    return assembler->cache_hit;
+}
+
+void CacheStore( Assembler_t* assembler ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
+
+    if ( !assembler->cache_entry || assembler->cache_hit ) return;
+
+    const char* directory = assembler->options.cache_dir;
+
+    if ( !LinkOrCopy( assembler->exe_file.address, assembler->cache_entry ) ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Can not store %s in cache \n" COLOR_RESET, assembler->exe_file.address );
+        return;
+    }
+
+    int lock = LockCache( directory );
+
+    CacheStats_t stats = {};
+    ReadStats( directory, &stats );
+
+    size_t evictions = stats.evictions;
+    ScanEntries( directory, assembler->options.cache_limit, &stats );
+
+    if ( stats.evictions != evictions ) WriteStats( directory, &stats );
+
+    UnlockCache( lock );
+}
+
+void CachePrintStats( const Assembler_t* assembler ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
+
+    const char* directory = assembler->options.cache_dir;
+    if ( !directory ) return;
+
+    CacheStats_t stats = {};
+
+    int lock = LockCache( directory );
+    ReadStats( directory, &stats );
+    ScanEntries( directory, 0, &stats );
+    UnlockCache( lock );
+
+    fprintf( stderr, "Cache %s: hits = %lu, misses = %lu, evictions = %lu; entries = %lu, size = %.2f of %.2f MB \n",
+             ( assembler->cache_hit ) ? "hit" : "miss", stats.hits, stats.misses, stats.evictions,
+             stats.entries, ( double ) stats.size / MEGABYTE, ( double ) assembler->options.cache_limit / MEGABYTE );
+}
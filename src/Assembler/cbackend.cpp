@@ -0,0 +1,353 @@
+#include "assembler.h"
+
+// Трансляция байт-кода в самостоятельную программу на C ( -f c ).
+// Каждая инструкция становится прямолинейным кодом над локальным стеком, массивом регистров и RAM,
+// метки - целями goto, а RET - switch по адресам возврата всех CALL программы.
+// Сборка: cc -O2 program.c -o program -lm
+
+static const int C_SUCCESS_RESULT = 1;
+static const int C_FAIL_RESULT    = 0;
+
+static const char C_PRELUDE[] =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <math.h>\n"
+    "\n"
+    "#define PUSH( value )                                                   \\\n"
+    "    do {                                                                \\\n"
+    "        int pushed = ( value );                                         \\\n"
+    "        if ( sp == capacity ) stack = Grow( stack, &capacity );        \\\n"
+    "        stack[ sp++ ] = pushed;                                         \\\n"
+    "    } while ( 0 )\n"
+    "\n"
+    "#define RET_PUSH( value )                                               \\\n"
+    "    do {                                                                \\\n"
+    "        if ( ret_sp == ret_capacity ) ret_stack = Grow( ret_stack, &ret_capacity ); \\\n"
+    "        ret_stack[ ret_sp++ ] = ( value );                              \\\n"
+    "    } while ( 0 )\n"
+    "\n"
+    "#define POP()  ( stack[ --sp ] )\n"
+    "#define TOP    ( stack[ sp - 1 ] )\n"
+    "\n"
+    "/* Арифметика по модулю 2^32, как у процессора */\n"
+    "#define WRAP( a, op, b ) ( int ) ( ( unsigned ) ( a ) op ( unsigned ) ( b ) )\n"
+    "\n"
+    "static inline int* Grow( int* data, size_t* capacity ) {\n"
+    "    *capacity = ( *capacity > 0 ) ? *capacity * 2 : 8;\n"
+    "    data = ( int* ) realloc( data, *capacity * sizeof( int ) );\n"
+    "    if ( !data ) {\n"
+    "        fprintf( stderr, \"Memory allocation error \\n\" );\n"
+    "        abort();\n"
+    "    }\n"
+    "    return data;\n"
+    "}\n"
+    "\n"
+    "static inline int RamIndex( int ram_index ) {\n"
+    "    if ( ram_index < 0 || ( size_t ) ram_index >= RAM_SIZE ) {\n"
+    "        fprintf( stderr, \"\\x1b[31mRAM index out of bounds: %d\\x1b[0m\\n\", ram_index );\n"
+    "        abort();\n"
+    "    }\n"
+    "    return ram_index;\n"
+    "}\n"
+    "\n"
+    "static inline void RamRange( int address, int count ) {\n"
+    "    if ( address < 0 || count < 0 || ( size_t ) address + ( size_t ) count > RAM_SIZE ) {\n"
+    "        fprintf( stderr, \"\\x1b[31mRAM range out of bounds: %d words from %d\\x1b[0m\\n\", count, address );\n"
+    "        abort();\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static inline void Fill( int* dst, int value, int count ) {\n"
+    "    for ( int i = 0; i < count; i++ ) dst[ i ] = value;\n"
+    "}\n"
+    "\n"
+    "static inline int Compare( const int* a, const int* b, int count ) {\n"
+    "    for ( int i = 0; i < count; i++ ) {\n"
+    "        if ( a[ i ] != b[ i ] ) return ( a[ i ] < b[ i ] ) ? -1 : 1;\n"
+    "    }\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "static inline void VectorAdd( int* dst, const int* a, const int* b, int len ) {\n"
+    "    for ( int i = 0; i < len; i++ ) dst[ i ] = WRAP( a[ i ], +, b[ i ] );\n"
+    "}\n"
+    "\n"
+    "static inline void VectorMul( int* dst, const int* a, const int* b, int len ) {\n"
+    "    for ( int i = 0; i < len; i++ ) dst[ i ] = WRAP( a[ i ], *, b[ i ] );\n"
+    "}\n"
+    "\n"
+    "static inline int VectorSum( const int* a, int len ) {\n"
+    "    unsigned sum = 0;\n"
+    "    for ( int i = 0; i < len; i++ ) sum += ( unsigned ) a[ i ];\n"
+    "    return ( int ) sum;\n"
+    "}\n"
+    "\n"
+    "static inline int VectorDot( const int* a, const int* b, int len ) {\n"
+    "    unsigned sum = 0;\n"
+    "    for ( int i = 0; i < len; i++ ) sum += ( unsigned ) a[ i ] * ( unsigned ) b[ i ];\n"
+    "    return ( int ) sum;\n"
+    "}\n"
+    "\n"
+    "static inline int Divisor( int b ) {\n"
+    "    if ( b == 0 ) {\n"
+    "        fprintf( stderr, \"Division by zero \\n\" );\n"
+    "        abort();\n"
+    "    }\n"
+    "    return b;\n"
+    "}\n"
+    "\n"
+    "static inline int Pow( int base, int indicator ) {\n"
+    "    int power = 1;\n"
+    "    for ( int i = 0; i < indicator; i++ ) {\n"
+    "        power = WRAP( power, *, base );\n"
+    "    }\n"
+    "    return power;\n"
+    "}\n"
+    "\n"
+    "static inline int In( void ) {\n"
+    "    int number = 0;\n"
+    "    fprintf( stderr, \"Input a number: \" );\n"
+    "    if ( scanf( \"%d\", &number ) != 1 ) number = 0;\n"
+    "    return number;\n"
+    "}\n"
+    "\n"
+    "int main( void ) {\n"
+    "    size_t capacity     = 0;\n"
+    "    size_t sp           = 0;\n"
+    "    int*   stack        = NULL;\n"
+    "\n"
+    "    size_t ret_capacity = 0;\n"
+    "    size_t ret_sp       = 0;\n"
+    "    int*   ret_stack    = NULL;\n"
+    "\n"
+    "    int        regs[ REGS_NUMBER ] = { 0 };\n"
+    "    static int RAM [ RAM_SIZE    ] = { 0 };\n"
+    "\n";
+
+static const char C_EPILOGUE[] =
+    "\n"
+    "end:\n"
+    "    ( void ) regs;\n"
+    "    ( void ) RAM;\n"
+    "    ( void ) ret_sp;\n"
+    "    ( void ) ret_capacity;\n"
+    "    free( stack );\n"
+    "    free( ret_stack );\n"
+    "    return 0;\n"
+    "}\n";
+
+// Слов операнда у команды, -1 - неизвестная команда
+static int ArgsNumber( int command ) {
+    const Opcode_t* opcode = FindOpcodeByCode( command );
+
+    return ( opcode ) ? ( int ) opcode->size - 1 : -1;
+}
+
+static const char* CommandName( int command ) {
+    const Opcode_t* opcode = FindOpcodeByCode( command );
+
+    return ( opcode ) ? opcode->name : "?";
+}
+
+static bool IsJump( int command ) {
+    const Opcode_t* opcode = FindOpcodeByCode( command );
+
+    return opcode && opcode->operand == OPERAND_LABEL;
+}
+
+// Переход на адрес вне начала инструкции ведет в конец программы, как и у процессора
+static void PrintGoto( FILE* file, const bool* is_start, size_t count, int target ) {
+    if ( target >= 0 && ( size_t ) target < count && is_start[ target ] ) {
+        fprintf( file, "goto L_%d;", target );
+    } else {
+        fprintf( file, "goto end;" );
+    }
+}
+
+static const char* ConditionOperator( int command ) {
+    switch ( command ) {
+        case JB_CMD:  return "<";
+        case JA_CMD:  return ">";
+        case JBE_CMD: return "<=";
+        case JAE_CMD: return ">=";
+        case JE_CMD:  return "==";
+        default:      return NULL;
+    }
+}
+
+static void PrintInstruction( FILE* file, const int* code, size_t address, const bool* is_start, size_t count ) {
+    int command = code[ address ];
+    int arg     = ( ArgsNumber( command ) > 0 ) ? code[ address + 1 ] : 0;
+
+    fprintf( file, "    " );
+
+    switch ( command ) {
+        case PUSH_CMD:  fprintf( file, "PUSH( %d );", arg ); break;
+        case POP_CMD:   fprintf( file, "sp--;" ); break;
+        case ADD_CMD:   fprintf( file, "sp--; TOP = WRAP( TOP, +, stack[ sp ] );" ); break;
+        case SUB_CMD:   fprintf( file, "sp--; TOP = WRAP( TOP, -, stack[ sp ] );" ); break;
+        case MUL_CMD:   fprintf( file, "sp--; TOP = WRAP( TOP, *, stack[ sp ] );" ); break;
+        case DIV_CMD:   fprintf( file, "sp--; TOP = TOP / Divisor( stack[ sp ] );" ); break;
+        case POW_CMD:   fprintf( file, "sp--; TOP = Pow( TOP, stack[ sp ] );" ); break;
+        case SQRT_CMD:  fprintf( file, "TOP = ( int ) sqrt( TOP );" ); break;
+        case IN_CMD:    fprintf( file, "PUSH( In() );" ); break;
+        case OUT_CMD:   fprintf( file, "fprintf( stderr, \"Output: %%d \\n\", POP() );" ); break;
+        case PUSHR_CMD: fprintf( file, "PUSH( regs[ %d ] );", arg ); break;
+        case POPR_CMD:  fprintf( file, "regs[ %d ] = POP();", arg ); break;
+
+        case PUSHM_CMD:  fprintf( file, "PUSH( RAM[ RamIndex( regs[ %d ] ) ] );", arg ); break;
+        case PUSHMA_CMD: fprintf( file, "PUSH( RAM[ RamIndex( %d ) ] );", arg ); break;
+        case POPM_CMD:   fprintf( file, "{ int value = POP(); RAM[ RamIndex( regs[ %d ] ) ] = value; }", arg ); break;
+        case POPMA_CMD:  fprintf( file, "{ int value = POP(); RAM[ RamIndex( %d ) ] = value; }", arg ); break;
+
+        case MEMSET_CMD:
+            fprintf( file, "{ int count = POP(); int value = POP(); int dst = POP(); "
+                           "RamRange( dst, count ); Fill( RAM + dst, value, count ); }" );
+            break;
+        case MEMCPY_CMD:
+            fprintf( file, "{ int count = POP(); int src = POP(); int dst = POP(); RamRange( src, count ); "
+                           "RamRange( dst, count ); memmove( RAM + dst, RAM + src, ( size_t ) count * sizeof( int ) ); }" );
+            break;
+        case MEMCMP_CMD:
+            fprintf( file, "{ int count = POP(); int b = POP(); int a = POP(); RamRange( a, count ); "
+                           "RamRange( b, count ); PUSH( Compare( RAM + a, RAM + b, count ) ); }" );
+            break;
+
+        case VADD_CMD:
+        case VMUL_CMD:
+            fprintf( file, "{ int len = POP(); int b = POP(); int a = POP(); int dst = POP(); RamRange( a, len ); "
+                           "RamRange( b, len ); RamRange( dst, len ); %s( RAM + dst, RAM + a, RAM + b, len ); }",
+                     ( command == VADD_CMD ) ? "VectorAdd" : "VectorMul" );
+            break;
+        case VSUM_CMD:
+            fprintf( file, "{ int len = POP(); int a = POP(); RamRange( a, len ); PUSH( VectorSum( RAM + a, len ) ); }" );
+            break;
+        case VDOT_CMD:
+            fprintf( file, "{ int len = POP(); int b = POP(); int a = POP(); RamRange( a, len ); "
+                           "RamRange( b, len ); PUSH( VectorDot( RAM + a, RAM + b, len ) ); }" );
+            break;
+
+        case JMP_CMD:
+            PrintGoto( file, is_start, count, arg );
+            break;
+
+        case JB_CMD: case JA_CMD: case JBE_CMD: case JAE_CMD: case JE_CMD:
+            fprintf( file, "sp -= 2; if ( stack[ sp ] %s stack[ sp + 1 ] ) ", ConditionOperator( command ) );
+            PrintGoto( file, is_start, count, arg );
+            break;
+
+        case CALL_CMD:
+            fprintf( file, "RET_PUSH( %lu ); ", address + 2 );
+            PrintGoto( file, is_start, count, arg );
+            break;
+
+        case RET_CMD:
+            fprintf( file, "switch ( ret_stack[ --ret_sp ] ) {\n" );
+            for ( size_t i = 0; i < count; i++ ) {
+                if ( is_start[i] && code[i] == CALL_CMD && i + 2 < count ) {
+                    fprintf( file, "        case %lu: goto L_%lu;\n", i + 2, i + 2 );
+                }
+            }
+            fprintf( file, "        default: goto end;\n    }" );
+            break;
+
+        case HLT_CMD:
+            fprintf( file, "goto end;" );
+            break;
+
+        default:
+            assert( 0 && "Unknown command in C backend" );
+            break;
+    }
+
+    if ( ArgsNumber( command ) > 0 ) fprintf( file, "  /* %s %d */\n", CommandName( command ), arg );
+    else                             fprintf( file, "  /* %s */\n",    CommandName( command ) );
+}
+
+int OutputInCFile( Assembler_t* assembler ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
+
+    PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ )
+
+    const int* code  = assembler->byte_code;
+    size_t     count = assembler->instruction_cnt;
+
+    bool* is_start  = ( bool* ) calloc ( count + 1, sizeof( bool ) );
+    bool* is_target = ( bool* ) calloc ( count + 1, sizeof( bool ) );
+    assert( is_start && is_target && "Error in memory allocation for C backend \n" );
+
+    // Границы инструкций и проверка аргументов
+    for ( size_t i = 0; i < count; ) {
+        int args_number = ArgsNumber( code[i] );
+
+        if ( args_number < 0 || i + ( size_t ) args_number >= count ) {
+            fprintf( stderr, COLOR_BRIGHT_RED "Incorrect byte code at word %lu for C output \n" COLOR_RESET, i );
+            free( is_start ); free( is_target );
+            return C_FAIL_RESULT;
+        }
+
+        int command = code[i];
+        bool has_register = ( command == PUSHR_CMD || command == POPR_CMD || command == PUSHM_CMD || command == POPM_CMD );
+        if ( has_register && ( code[ i + 1 ] < 0 || code[ i + 1 ] >= REGS_NUMBER ) ) {
+            fprintf( stderr, COLOR_BRIGHT_RED "Register %d is out of range ( 0..%d ) for C output \n" COLOR_RESET,
+                     code[ i + 1 ], REGS_NUMBER - 1 );
+            free( is_start ); free( is_target );
+            return C_FAIL_RESULT;
+        }
+
+        is_start[i] = true;
+        i += 1 + ( size_t ) args_number;
+    }
+
+    // Метки нужны только целям переходов и адресам возврата
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( !is_start[i] || !IsJump( code[i] ) ) continue;
+
+        int target = code[ i + 1 ];
+        if ( target >= 0 && ( size_t ) target < count && is_start[ target ] ) {
+            is_target[ target ] = true;
+        }
+
+        if ( code[i] == CALL_CMD && i + 2 < count ) {
+            is_target[ i + 2 ] = true;
+        }
+    }
+
+    // Текст собирается в памяти и пишется через WriteFileAtomic, как байт-код: недописанный .c никто не увидит
+    char*  text   = NULL;
+    size_t length = 0;
+    FILE*  file   = open_memstream( &text, &length );
+    assert( file && "Memory allocation error \n" );
+
+    fprintf( file, "/* Сгенерировано ассемблером из %s */\n\n", assembler->asm_file.address );
+    // Размер RAM можно переопределить при сборке: cc -DRAM_SIZE=...
+    fprintf( file, "#define REGS_NUMBER %d\n#ifndef RAM_SIZE\n#define RAM_SIZE    %lu\n#endif\n\n", REGS_NUMBER, RAM_DEFAULT_SIZE );
+    fputs( C_PRELUDE, file );
+
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( !is_start[i] ) continue;
+
+        if ( is_target[i] ) {
+            fprintf( file, "L_%lu:\n", i );
+        }
+
+        PrintInstruction( file, code, i, is_start, count );
+    }
+
+    fputs( C_EPILOGUE, file );
+
+    int result_of_fclose = fclose( file );
+    assert( result_of_fclose == 0 && "Memory allocation error \n" );
+
+    struct iovec part = { text, length };
+    bool written = WriteFileAtomic( assembler->exe_file.address, &part, 1 );
+
+    free( text );
+    free( is_start );
+    free( is_target );
+
+    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
+
+    return ( written ) ? C_SUCCESS_RESULT : C_FAIL_RESULT;
+}
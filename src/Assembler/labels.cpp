@@ -0,0 +1,216 @@
+#include "assembler.h"
+
+// Таблица меток: открытая адресация с линейным пробированием, заполнение не больше половины.
+// Имена копируются в арену один раз и не перемещаются при расширении таблицы.
+
+static uint64_t LabelHash( const char* name, size_t length ) {
+    uint64_t hash = 14695981039346656037ull;  // FNV-1a
+
+    for ( size_t i = 0; i < length; i++ ) {
+        hash ^= ( unsigned char ) name[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static Label_t* FindSlot( Label_t* slots, size_t capacity, const char* name, size_t length, uint64_t hash ) {
+    size_t mask  = capacity - 1;
+    size_t index = hash & mask;
+
+    while ( slots[ index ].name ) {
+        const Label_t* label = slots + index;
+
+        if ( label->hash == hash && label->length == length && memcmp( label->name, name, length ) == 0 ) {
+            break;
+        }
+
+        index = ( index + 1 ) & mask;
+    }
+
+    return slots + index;
+}
+
+static void LabelTableGrow( LabelTable_t* table ) {
+    size_t new_capacity = ( table->capacity > 0 ) ? table->capacity * 2 : LABELS_INITIAL_CAPACITY;
+
+    Label_t* new_slots = ( Label_t* ) calloc ( new_capacity, sizeof( *new_slots ) );
+    assert( new_slots && "Error in memory allocation for labels \n" );
+
+    for ( size_t i = 0; i < table->capacity; i++ ) {
+        const Label_t* label = table->slots + i;
+        if ( !label->name ) continue;
+
+        *FindSlot( new_slots, new_capacity, label->name, label->length, label->hash ) = *label;
+    }
+
+    free( table->slots );
+    table->slots    = new_slots;
+    table->capacity = new_capacity;
+}
+
+static const char* ArenaCopy( LabelTable_t* table, const char* name, size_t length ) {
+    LabelArenaBlock_t* block = table->arena;
+
+    if ( !block || block->capacity - block->used < length + 1 ) {
+        size_t capacity = ( length + 1 > LABEL_ARENA_BLOCK_SIZE ) ? length + 1 : LABEL_ARENA_BLOCK_SIZE;
+
+        block = ( LabelArenaBlock_t* ) calloc ( 1, sizeof( *block ) );
+        assert( block && "Error in memory allocation for labels arena \n" );
+
+        block->data = ( char* ) calloc ( capacity, sizeof( *block->data ) );
+        assert( block->data && "Error in memory allocation for labels arena \n" );
+
+        block->capacity = capacity;
+        block->prev     = table->arena;
+        table->arena    = block;
+    }
+
+    char* copy = block->data + block->used;
+    memcpy( copy, name, length );
+    copy[ length ] = '\0';
+    block->used += length + 1;
+
+    return copy;
+}
+
+void LabelTableCtor( LabelTable_t* table ) {
+    my_assert( table, ASSERT_ERR_NULL_PTR );
+
+    *table = {};
+    LabelTableGrow( table );
+}
+
+void LabelTableDtor( LabelTable_t* table ) {
+    my_assert( table, ASSERT_ERR_NULL_PTR );
+
+    while ( table->arena ) {
+        LabelArenaBlock_t* prev = table->arena->prev;
+
+        free( table->arena->data );
+        free( table->arena );
+
+        table->arena = prev;
+    }
+
+    free( table->slots );
+    *table = {};
+}
+
+// Таблица перестраивается без удаленных меток; их имена остаются в арене до LabelTableDtor
+size_t LabelTableCompact( LabelTable_t* table ) {
+    my_assert( table, ASSERT_ERR_NULL_PTR );
+
+    Label_t* new_slots = ( Label_t* ) calloc ( table->capacity, sizeof( *new_slots ) );
+    assert( new_slots && "Error in memory allocation for labels \n" );
+
+    size_t removed = 0;
+    for ( size_t i = 0; i < table->capacity; i++ ) {
+        const Label_t* label = table->slots + i;
+        if ( !label->name ) continue;
+
+        if ( label->address == -1 ) {
+            removed++;
+            continue;
+        }
+
+        *FindSlot( new_slots, table->capacity, label->name, label->length, label->hash ) = *label;
+    }
+
+    free( table->slots );
+    table->slots  = new_slots;
+    table->count -= removed;
+
+    return removed;
+}
+
+int FindLabelAddress( const Assembler_t* assembler, const char* label_name, size_t length ) {
+    my_assert( assembler,   ASSERT_ERR_NULL_PTR );
+    my_assert( label_name,  ASSERT_ERR_NULL_PTR );
+
+    const LabelTable_t* table = &( assembler->labels );
+    if ( table->capacity == 0 ) return -1;
+
+    const Label_t* label = FindSlot( table->slots, table->capacity, label_name, length, LabelHash( label_name, length ) );
+
+    return label->name ? label->address : -1;  // -1 - метка не найдена
+}
+
+int AddLabel( Assembler_t* assembler, const char* label_name, size_t length, int address ) {
+    my_assert( assembler,   ASSERT_ERR_NULL_PTR );
+    my_assert( label_name,  ASSERT_ERR_NULL_PTR );
+
+    LabelTable_t* table = &( assembler->labels );
+    if ( ( table->count + 1 ) * 2 > table->capacity ) {
+        LabelTableGrow( table );
+    }
+
+    uint64_t hash  = LabelHash( label_name, length );
+    Label_t* label = FindSlot( table->slots, table->capacity, label_name, length, hash );
+
+    if ( label->name ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Label '%.*s' already defined\n" COLOR_RESET, ( int ) length, label_name );
+        return FAIL_RESULT;
+    }
+
+    label->name    = ArenaCopy( table, label_name, length );
+    label->length  = length;
+    label->hash    = hash;
+    label->address = address;
+    table->count++;
+
+    return SUCCESS_RESULT;
+}
+
+void AddFixup( Assembler_t* assembler, const char* label_name, size_t length, size_t word,
+               size_t line, const char* source, int command ) {
+    my_assert( assembler,   ASSERT_ERR_NULL_PTR );
+    my_assert( label_name,  ASSERT_ERR_NULL_PTR );
+
+    if ( assembler->fixups_count == assembler->fixups_capacity ) {
+        size_t new_capacity = ( assembler->fixups_capacity > 0 ) ? assembler->fixups_capacity * 2 : LABELS_INITIAL_CAPACITY;
+
+        Fixup_t* new_fixups = ( Fixup_t* ) realloc ( assembler->fixups, new_capacity * sizeof( *new_fixups ) );
+        assert( new_fixups && "Error in memory allocation for fixups \n" );
+
+        assembler->fixups          = new_fixups;
+        assembler->fixups_capacity = new_capacity;
+    }
+
+    Fixup_t* fixup = assembler->fixups + assembler->fixups_count++;
+    fixup->name    = label_name;
+    fixup->length  = length;
+    fixup->word    = word;
+    fixup->line    = line;
+    fixup->source  = source;
+    fixup->command = command;
+}
+
+int ResolveFixups( Assembler_t* assembler ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
+
+    int result = SUCCESS_RESULT;
+
+    // Сообщаем обо всех неизвестных метках сразу, а не только о первой
+    for ( size_t i = 0; i < assembler->fixups_count; i++ ) {
+        const Fixup_t* fixup = assembler->fixups + i;
+
+        int address = FindLabelAddress( assembler, fixup->name, fixup->length );
+        if ( address != -1 ) {
+            assembler->byte_code[ fixup->word ] = address;
+            continue;
+        }
+
+        fprintf( stderr, COLOR_BRIGHT_RED "%s '%.*s' not found in file: %s:%lu: %.*s\n" COLOR_RESET,
+                 ( fixup->command == CALL_CMD ) ? "Function" : "Label", ( int ) fixup->length, fixup->name,
+                 assembler->asm_file.address, fixup->line, ( int ) strcspn( fixup->source, "\r\n" ), fixup->source );
+        result = FAIL_RESULT;
+    }
+
+    free( assembler->fixups );
+    assembler->fixups          = NULL;
+    assembler->fixups_count    = 0;
+    assembler->fixups_capacity = 0;
+
+    return result;
+}
@@ -0,0 +1,148 @@
+#include <limits.h>
+
+#include "assembler.h"
+
+// Лексер ассемблера: токены - указатель и длина прямо в буфере файла, без копий и sscanf.
+// Строка заканчивается на '\n', ';' начинает комментарий до конца строки.
+// Запятая разделяет операнды ( VADD 100, 200, RAX, RCX ) и пропускается, как пробел.
+
+static bool IsBlank( char c ) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f' || c == ',';
+}
+
+static bool IsDelimiter( char c ) {
+    return IsBlank( c ) || c == '\n' || c == ';' || c == '\0';
+}
+
+// RAX или AX -> номер регистра, иначе -1
+static int RegisterNumber( const char* ptr, size_t len ) {
+    if ( len == 3 && ptr[0] == 'R' && ptr[2] == 'X' && ptr[1] >= 'A' && ptr[1] <= 'Z' ) return ptr[1] - 'A' + 1;
+    if ( len == 2 && ptr[1] == 'X' && ptr[0] >= 'A' && ptr[0] <= 'Z' )                  return ptr[0] - 'A' + 1;
+
+    return -1;
+}
+
+// Целое со знаком во весь токен, в пределах int
+static bool ParseNumber( const char* ptr, size_t len, int* value ) {
+    size_t i = 0;
+    bool negative = false;
+
+    if ( len > 0 && ( ptr[0] == '-' || ptr[0] == '+' ) ) {
+        negative = ( ptr[0] == '-' );
+        i++;
+    }
+
+    if ( i == len ) return false;
+
+    long long number = 0;
+    for ( ; i < len; i++ ) {
+        if ( ptr[i] < '0' || ptr[i] > '9' ) return false;
+
+        number = number * 10 + ( ptr[i] - '0' );
+        if ( number > ( long long ) INT_MAX + 1 ) return false;
+    }
+
+    if ( negative ) number = -number;
+    if ( number > INT_MAX ) return false;
+
+    *value = ( int ) number;
+    return true;
+}
+
+static void ClassifyToken( Token_t* token ) {
+    const char* ptr = token->ptr;
+    size_t      len = token->len;
+
+    token->type  = TOKEN_WORD;
+    token->value = 0;
+
+    if ( ptr[0] == ':' ) {
+        token->type = TOKEN_LABEL;
+        return;
+    }
+
+    if ( ParseNumber( ptr, len, &( token->value ) ) ) {
+        token->type = TOKEN_NUMBER;
+        return;
+    }
+
+    int reg = RegisterNumber( ptr, len );
+    if ( reg != -1 ) {
+        token->type  = TOKEN_REGISTER;
+        token->value = reg;
+        return;
+    }
+
+    if ( len > 2 && ptr[0] == '[' && ptr[ len - 1 ] == ']' ) {
+        reg = RegisterNumber( ptr + 1, len - 2 );
+        if ( reg != -1 ) {
+            token->type  = TOKEN_MEMORY;
+            token->value = reg;
+        }
+    }
+}
+
+void LexerCtor( Lexer_t* lexer, const char* buffer, size_t size ) {
+    my_assert( lexer,  ASSERT_ERR_NULL_PTR );
+    my_assert( buffer, ASSERT_ERR_NULL_PTR );
+
+    *lexer = {};
+    lexer->cursor     = buffer;
+    lexer->end        = buffer + size;
+    lexer->line_start = buffer;
+    lexer->line       = 1;
+}
+
+bool LexToken( Lexer_t* lexer, Token_t* token ) {
+    my_assert( lexer, ASSERT_ERR_NULL_PTR );
+    my_assert( token, ASSERT_ERR_NULL_PTR );
+
+    const char* cursor = lexer->cursor;
+    const char* end    = lexer->end;
+
+    while ( cursor < end && IsBlank( *cursor ) ) cursor++;
+
+    if ( cursor < end && *cursor == ';' ) {
+        const char* newline = ( const char* ) memchr( cursor, '\n', ( size_t ) ( end - cursor ) );
+        cursor = ( newline ) ? newline : end;
+    }
+
+    token->ptr    = cursor;
+    token->line   = lexer->line;
+    token->column = ( size_t ) ( cursor - lexer->line_start ) + 1;
+
+    if ( cursor == end || *cursor == '\n' || *cursor == '\0' ) {
+        token->type  = TOKEN_END;
+        token->len   = 0;
+        token->value = 0;
+
+        lexer->cursor = cursor;
+        return false;
+    }
+
+    const char* token_end = cursor;
+    while ( token_end < end && !IsDelimiter( *token_end ) ) token_end++;
+
+    token->len    = ( size_t ) ( token_end - cursor );
+    lexer->cursor = token_end;
+
+    ClassifyToken( token );
+
+    return true;
+}
+
+bool LexNextLine( Lexer_t* lexer ) {
+    my_assert( lexer, ASSERT_ERR_NULL_PTR );
+
+    const char* newline = ( const char* ) memchr( lexer->cursor, '\n', ( size_t ) ( lexer->end - lexer->cursor ) );
+    if ( !newline ) {
+        lexer->cursor = lexer->end;
+        return false;
+    }
+
+    lexer->cursor     = newline + 1;
+    lexer->line_start = newline + 1;
+    lexer->line++;
+
+    return lexer->cursor < lexer->end;
+}
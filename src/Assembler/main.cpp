@@ -8,6 +8,13 @@ int main( int argc, char** argv ) {
 
     PRINT( COLOR_BRIGHT_WHITE "FILES:\nfor input - %s\nfor output - %s\n", assembler.asm_file.address, assembler.exe_file.address );
 
+    if ( CacheLookup( &assembler ) ) {
+        if ( assembler.options.stats ) CachePrintStats( &assembler );
+
+        AssemblerDtor( &assembler );
+        return 0;
+    }
+
     int processing_result = AsmCodeToByteCode( &assembler );
 
     if ( processing_result != 1 ) {
@@ -17,7 +24,19 @@ int main( int argc, char** argv ) {
         return 1;
     }
 
-    OutputInFile( &assembler );
+    int output_result = ( assembler.options.format == OUTPUT_C    ) ? OutputInCFile     ( &assembler )
+                      : ( assembler.options.format == OUTPUT_TEXT ) ? OutputInFile      ( &assembler )
+                      :                                                OutputInBinaryFile( &assembler );
+
+    if ( output_result != 1 ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Emergency shutdown of the assembler \n" );
+        AssemblerDtor( &assembler );
+
+        return 1;
+    }
+
+    CacheStore( &assembler );
+    if ( assembler.options.stats ) CachePrintStats( &assembler );
 
     AssemblerDtor( &assembler );
     return 0;
@@ -0,0 +1,614 @@
+#include <limits.h>
+
+#include "assembler.h"
+
+// Оптимизатор байт-кода ( -O1 ) после разрешения меток. Программа разбирается в список инструкций,
+// начала базовых блоков - цели переходов и адреса возврата после CALL. Внутри блока хвост уже
+// выданных инструкций переписывается по образцам, пока образцы применяются:
+//   PUSH a; PUSH b; ADD/SUB/MUL/DIV/POW  ->  PUSH ( a op b )         свертка констант
+//   PUSH a; SQRT                         ->  PUSH sqrt( a )
+//   PUSH/PUSHR; POP,  PUSHR X; POPR X    ->  ничего
+//   PUSH 0; ADD/SUB,  PUSH 1; MUL/DIV/POW ->  ничего                 нейтральный операнд
+//   PUSH c; ADD; PUSH d; SUB             ->  PUSH ( c - d ); ADD      цепочки констант ( и MUL )
+// Перед этим переходы на JMP перенаправляются в конец цепочки, JMP на RET/HLT заменяется ими,
+// а после - удаляются JMP на следующую инструкцию. Старый адрес каждой инструкции сохраняется,
+// так что переходы и метки пересчитываются в конце по одной таблице адресов.
+// Арифметика сворачивается, только если результат помещается в int, как и при исполнении.
+//
+// -O2 дополнительно строит граф потока управления: блок кончается переходом, RET или HLT,
+// преемники - цель перехода и следующий блок ( после CALL - адрес возврата ). Блоки, недостижимые
+// от начала программы, удаляются: код после HLT, JMP и RET, функции без вызовов. Затем блоки,
+// связанные проваливанием, выкладываются цепочками; за цепочкой, которая кончается JMP, ставится
+// цепочка цели перехода, и JMP становится не нужен. Метки, на которые не осталось переходов, удаляются.
+
+struct OptInstr_t {
+    int    code      = 0;
+    int    arg       = 0;      // Для переходов - старый адрес цели до пересчета
+    size_t size      = 0;
+    size_t address   = 0;      // Старый адрес ( у свертки - адрес первой инструкции окна )
+    bool   is_target = false;  // Начало блока: сюда переходят или возвращаются
+};
+
+struct OptStats_t {
+    size_t folded      = 0;  // Свертки и сокращения
+    size_t removed     = 0;  // Удаленные пары без эффекта
+    size_t threaded    = 0;  // Перенаправленные переходы
+    size_t jumps       = 0;  // Удаленные JMP на следующую инструкцию
+    size_t blocks      = 0;  // -O2: базовые блоки до удаления недостижимых
+    size_t dead        = 0;  // Недостижимые блоки
+    size_t dead_instrs = 0;  // и их инструкции
+    size_t laid_out    = 0;  // JMP, ставшие не нужны после раскладки цепочек
+    size_t labels      = 0;  // Удаленные метки без переходов
+};
+
+// Базовый блок - инструкции [begin, end) списка
+struct OptBlock_t {
+    size_t begin = 0;
+    size_t end   = 0;
+    size_t jump  = SIZE_MAX;  // Блок - цель перехода в конце, SIZE_MAX - нет перехода или переход в конец программы
+    bool   falls = false;     // Последняя инструкция передает управление следующему блоку
+    bool   live  = false;
+};
+
+static bool IsPush( const OptInstr_t* instr, int value ) {
+    return instr->code == PUSH_CMD && instr->arg == value;
+}
+
+static bool IsJump( int code ) {
+    const Opcode_t* opcode = FindOpcodeByCode( code );
+
+    return opcode && opcode->operand == OPERAND_LABEL;
+}
+
+// После этих команд управление не переходит к следующей инструкции
+static bool IsTerminator( int code ) {
+    return code == JMP_CMD || code == RET_CMD || code == HLT_CMD;
+}
+
+// a op b по правилам процессора; false - результат не int или не определен
+static bool FoldArithmetic( int code, int a, int b, int* result ) {
+    switch ( code ) {
+        case ADD_CMD: return !__builtin_add_overflow( a, b, result );
+        case SUB_CMD: return !__builtin_sub_overflow( a, b, result );
+        case MUL_CMD: return !__builtin_mul_overflow( a, b, result );
+
+        case DIV_CMD:
+            if ( b == 0 || ( a == INT_MIN && b == -1 ) ) return false;
+            *result = a / b;
+            return true;
+
+        // Как ProcPow: показатель меньше 1 дает 1. Основания 0, 1 и -1 не растут - ответ сразу,
+        // остальные переполняют int не больше чем за 31 умножение
+        case POW_CMD: {
+            if ( b < 1 ) {
+                *result = 1;
+                return true;
+            }
+            if ( a == 0 || a == 1 ) {
+                *result = a;
+                return true;
+            }
+            if ( a == -1 ) {
+                *result = ( b % 2 == 0 ) ? 1 : -1;
+                return true;
+            }
+
+            int power = 1;
+            for ( int i = 0; i < b; i++ ) {
+                if ( __builtin_mul_overflow( power, a, &power ) ) return false;
+            }
+            *result = power;
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+static OptInstr_t* DecodeProgram( const Assembler_t* assembler, size_t* count ) {
+    const int* code  = assembler->byte_code;
+    size_t     words = assembler->instruction_cnt;
+
+    OptInstr_t* instrs = ( OptInstr_t* ) calloc ( words + 1, sizeof( *instrs ) );
+    assert( instrs && "Memory allocation error \n" );
+
+    size_t n = 0;
+    for ( size_t word = 0; word < words; n++ ) {
+        const Opcode_t* opcode = FindOpcodeByCode( code[ word ] );
+
+        instrs[n].code    = code[ word ];
+        instrs[n].size    = ( opcode ) ? opcode->size : 1;
+        instrs[n].arg     = ( instrs[n].size > 1 && word + 1 < words ) ? code[ word + 1 ] : 0;
+        instrs[n].address = word;
+
+        word += instrs[n].size;
+    }
+
+    *count = n;
+    return instrs;
+}
+
+// Номер инструкции по старому адресу, SIZE_MAX - не начало инструкции
+static size_t* IndexByAddress( const OptInstr_t* instrs, size_t count, size_t words ) {
+    size_t* index_of = ( size_t* ) calloc ( words + 1, sizeof( *index_of ) );
+    assert( index_of && "Memory allocation error \n" );
+
+    for ( size_t i = 0; i <= words; i++ ) index_of[i] = SIZE_MAX;
+    for ( size_t i = 0; i < count;  i++ ) index_of[ instrs[i].address ] = i;
+
+    return index_of;
+}
+
+static void MarkTargets( OptInstr_t* instrs, size_t count, const size_t* index_of, size_t words ) {
+    if ( count > 0 ) instrs[0].is_target = true;
+
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( !IsJump( instrs[i].code ) ) continue;
+
+        int target = instrs[i].arg;
+        if ( target >= 0 && ( size_t ) target < words && index_of[ target ] != SIZE_MAX ) {
+            instrs[ index_of[ target ] ].is_target = true;
+        }
+
+        if ( instrs[i].code == CALL_CMD && i + 1 < count ) {
+            instrs[ i + 1 ].is_target = true;
+        }
+    }
+}
+
+static void ThreadJumps( OptInstr_t* instrs, size_t count, const size_t* index_of, size_t words, OptStats_t* stats ) {
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( !IsJump( instrs[i].code ) ) continue;
+
+        int    target = instrs[i].arg;
+        size_t steps  = 0;
+
+        // Ограничение шагов - защита от цикла из JMP
+        while ( target >= 0 && ( size_t ) target < words && index_of[ target ] != SIZE_MAX && steps < count ) {
+            const OptInstr_t* next = instrs + index_of[ target ];
+            if ( next->code != JMP_CMD || next->arg == target ) break;
+
+            target = next->arg;
+            steps++;
+        }
+
+        if ( target != instrs[i].arg ) {
+            instrs[i].arg = target;
+            stats->threaded++;
+        }
+
+        if ( instrs[i].code != JMP_CMD || target < 0 || ( size_t ) target >= words || index_of[ target ] == SIZE_MAX ) continue;
+
+        const OptInstr_t* final = instrs + index_of[ target ];
+        if ( final->code == RET_CMD || final->code == HLT_CMD ) {
+            instrs[i].code = final->code;
+            instrs[i].size = 1;
+            instrs[i].arg  = 0;
+            stats->threaded++;
+        }
+    }
+}
+
+// Последние length инструкций out - одно окно: внутрь, кроме первой, не переходят
+static bool TailInBlock( const OptInstr_t* out, size_t n, size_t length ) {
+    if ( n < length ) return false;
+
+    for ( size_t i = n - length + 1; i < n; i++ ) {
+        if ( out[i].is_target ) return false;
+    }
+
+    return true;
+}
+
+// Одна перезапись хвоста out; *pending_target - удалено начало блока, его унаследует следующая инструкция
+static bool RewriteTail( OptInstr_t* out, size_t* n, bool* pending_target, OptStats_t* stats ) {
+    OptInstr_t* t = out + *n;  // t[-1] - последняя выданная инструкция
+    int result = 0;
+
+    if ( TailInBlock( out, *n, 3 ) && t[-3].code == PUSH_CMD && t[-2].code == PUSH_CMD &&
+         FoldArithmetic( t[-1].code, t[-3].arg, t[-2].arg, &result ) ) {
+        t[-3].arg = result;
+        *n -= 2;
+        stats->folded++;
+        return true;
+    }
+
+    if ( TailInBlock( out, *n, 2 ) && t[-2].code == PUSH_CMD && t[-1].code == SQRT_CMD && t[-2].arg >= 0 ) {
+        t[-2].arg = ( int ) sqrt( t[-2].arg );
+        *n -= 1;
+        stats->folded++;
+        return true;
+    }
+
+    if ( TailInBlock( out, *n, 2 ) &&
+         ( ( ( t[-2].code == PUSH_CMD || t[-2].code == PUSHR_CMD ) && t[-1].code == POP_CMD ) ||
+           ( t[-2].code == PUSHR_CMD && t[-1].code == POPR_CMD && t[-2].arg == t[-1].arg ) ) ) {
+        *pending_target = *pending_target || t[-2].is_target;
+        *n -= 2;
+        stats->removed++;
+        return true;
+    }
+
+    if ( TailInBlock( out, *n, 2 ) &&
+         ( ( IsPush( t - 2, 0 ) && ( t[-1].code == ADD_CMD || t[-1].code == SUB_CMD ) ) ||
+           ( IsPush( t - 2, 1 ) && ( t[-1].code == MUL_CMD || t[-1].code == DIV_CMD || t[-1].code == POW_CMD ) ) ) ) {
+        *pending_target = *pending_target || t[-2].is_target;
+        *n -= 2;
+        stats->folded++;
+        return true;
+    }
+
+    // x + c - d = x + ( c - d ), x * c * d = x * ( c * d )
+    if ( TailInBlock( out, *n, 4 ) && t[-4].code == PUSH_CMD && t[-2].code == PUSH_CMD ) {
+        bool additive = ( t[-3].code == ADD_CMD || t[-3].code == SUB_CMD ) && ( t[-1].code == ADD_CMD || t[-1].code == SUB_CMD );
+        bool multiply = ( t[-3].code == MUL_CMD && t[-1].code == MUL_CMD );
+
+        int first  = ( t[-3].code == SUB_CMD ) ? -t[-4].arg : t[-4].arg;
+        int second = ( t[-1].code == SUB_CMD ) ? -t[-2].arg : t[-2].arg;
+
+        bool fits = ( additive && t[-4].arg != INT_MIN && t[-2].arg != INT_MIN &&
+                      !__builtin_add_overflow( first, second, &result ) ) ||
+                    ( multiply && !__builtin_mul_overflow( t[-4].arg, t[-2].arg, &result ) );
+
+        if ( fits ) {
+            t[-4].arg  = result;
+            t[-3].code = ( additive ) ? ADD_CMD : MUL_CMD;
+            *n -= 2;
+            stats->folded++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static size_t Peephole( OptInstr_t* instrs, size_t count, OptStats_t* stats ) {
+    size_t n = 0;
+    bool pending_target = false;
+
+    // Выход пишется поверх входа: n никогда не обгоняет i
+    for ( size_t i = 0; i < count; i++ ) {
+        instrs[n] = instrs[i];
+        instrs[n].is_target = instrs[n].is_target || pending_target;
+        pending_target = false;
+        n++;
+
+        while ( RewriteTail( instrs, &n, &pending_target, stats ) ) {}
+    }
+
+    return n;
+}
+
+// Первая оставшаяся инструкция со старым адресом не меньше address
+static size_t FirstAtOrAfter( const OptInstr_t* instrs, size_t count, size_t address ) {
+    size_t left = 0, right = count;
+
+    while ( left < right ) {
+        size_t middle = ( left + right ) / 2;
+
+        if ( instrs[ middle ].address < address ) left  = middle + 1;
+        else                                      right = middle;
+    }
+
+    return left;
+}
+
+static size_t RemoveJumpsToNext( OptInstr_t* instrs, size_t count, OptStats_t* stats ) {
+    bool* to_next = ( bool* ) calloc ( count + 1, sizeof( *to_next ) );
+    assert( to_next && "Memory allocation error \n" );
+
+    // Удаление JMP может сделать соседний JMP переходом на следующую - до неподвижной точки
+    bool changed = true;
+    while ( changed ) {
+        changed = false;
+
+        for ( size_t i = 0; i < count; i++ ) {
+            to_next[i] = instrs[i].code == JMP_CMD && instrs[i].arg >= 0 && ( size_t ) instrs[i].arg > instrs[i].address &&
+                         FirstAtOrAfter( instrs, count, ( size_t ) instrs[i].arg ) == i + 1;
+        }
+
+        size_t n = 0;
+        for ( size_t i = 0; i < count; i++ ) {
+            if ( to_next[i] ) {
+                stats->jumps++;
+                changed = true;
+                continue;
+            }
+
+            instrs[ n++ ] = instrs[i];
+        }
+
+        count = n;
+    }
+
+    free( to_next );
+
+    return count;
+}
+
+// Номер инструкции - цели перехода; count - переход в конец программы
+static size_t JumpTarget( const OptInstr_t* instrs, size_t count, const OptInstr_t* jump ) {
+    return ( jump->arg < 0 ) ? count : FirstAtOrAfter( instrs, count, ( size_t ) jump->arg );
+}
+
+static OptBlock_t* BuildBlocks( const OptInstr_t* instrs, size_t count, size_t* blocks_count ) {
+    bool*   leader   = ( bool*   ) calloc ( count + 1, sizeof( *leader   ) );
+    size_t* block_of = ( size_t* ) calloc ( count + 1, sizeof( *block_of ) );
+    assert( leader && block_of && "Memory allocation error \n" );
+
+    leader[0] = true;
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( IsJump( instrs[i].code ) ) leader[ JumpTarget( instrs, count, instrs + i ) ] = true;
+        if ( IsJump( instrs[i].code ) || IsTerminator( instrs[i].code ) ) leader[ i + 1 ] = true;
+    }
+
+    size_t n = 0;
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( leader[i] ) n++;
+        block_of[i] = n - 1;
+    }
+    block_of[ count ] = SIZE_MAX;
+
+    OptBlock_t* blocks = ( OptBlock_t* ) calloc ( n + 1, sizeof( *blocks ) );
+    assert( blocks && "Memory allocation error \n" );
+
+    for ( size_t i = 0; i < count; i++ ) {
+        OptBlock_t* block = blocks + block_of[i];
+
+        if ( leader[i] ) block->begin = i;
+        block->end = i + 1;
+    }
+
+    for ( size_t b = 0; b < n; b++ ) {
+        const OptInstr_t* last = instrs + blocks[b].end - 1;
+
+        blocks[b].falls = !IsTerminator( last->code );
+        blocks[b].jump  = ( IsJump( last->code ) ) ? block_of[ JumpTarget( instrs, count, last ) ] : SIZE_MAX;
+    }
+
+    free( block_of );
+    free( leader );
+
+    *blocks_count = n;
+    return blocks;
+}
+
+// Обход графа от первого блока; RET возвращается только за CALL, а это уже преемник CALL
+static size_t RemoveUnreachable( OptInstr_t* instrs, size_t count, OptStats_t* stats ) {
+    if ( count == 0 ) return 0;
+
+    size_t      blocks_count = 0;
+    OptBlock_t* blocks       = BuildBlocks( instrs, count, &blocks_count );
+
+    size_t* stack = ( size_t* ) calloc ( blocks_count, sizeof( *stack ) );
+    assert( stack && "Memory allocation error \n" );
+
+    size_t top = 0;
+    blocks[0].live = true;
+    stack[ top++ ] = 0;
+
+    while ( top > 0 ) {
+        size_t b = stack[ --top ];
+        size_t next[] = { blocks[b].jump, ( blocks[b].falls ) ? b + 1 : SIZE_MAX };
+
+        for ( size_t k = 0; k < sizeof( next ) / sizeof( *next ); k++ ) {
+            if ( next[k] >= blocks_count || blocks[ next[k] ].live ) continue;
+
+            blocks[ next[k] ].live = true;
+            stack[ top++ ] = next[k];
+        }
+    }
+
+    size_t n = 0;
+    for ( size_t b = 0; b < blocks_count; b++ ) {
+        if ( !blocks[b].live ) {
+            stats->dead++;
+            stats->dead_instrs += blocks[b].end - blocks[b].begin;
+            continue;
+        }
+
+        for ( size_t i = blocks[b].begin; i < blocks[b].end; i++ ) {
+            instrs[ n++ ] = instrs[i];
+        }
+    }
+
+    stats->blocks += blocks_count;
+
+    free( stack );
+    free( blocks );
+
+    return n;
+}
+
+// Порядок выдачи инструкций: цепочки блоков, связанных проваливанием, не разрываются.
+// Первой идет цепочка входа, за цепочкой с JMP в конце - цепочка его цели, если она еще не выложена,
+// иначе - первая невыложенная по исходному порядку. Ненужный JMP получает size 0 и не выдается.
+// Цепочка, которая проваливается за конец программы, остается последней.
+static size_t* LayoutBlocks( OptInstr_t* instrs, size_t count, OptStats_t* stats ) {
+    size_t* order = ( size_t* ) calloc ( count + 1, sizeof( *order ) );
+    assert( order && "Memory allocation error \n" );
+
+    if ( count == 0 ) return order;
+
+    size_t      blocks_count = 0;
+    OptBlock_t* blocks       = BuildBlocks( instrs, count, &blocks_count );
+
+    // live здесь - цепочка уже выложена ( отмечается в ее первом блоке )
+    size_t chains = 0;
+    for ( size_t b = 0; b < blocks_count; b++ ) {
+        if ( b == 0 || !blocks[ b - 1 ].falls ) chains++;
+    }
+
+    size_t pinned = ( blocks[ blocks_count - 1 ].falls ) ? blocks_count - 1 : SIZE_MAX;
+    while ( pinned != SIZE_MAX && pinned > 0 && blocks[ pinned - 1 ].falls ) pinned--;
+
+    size_t n    = 0;
+    size_t scan = 0;
+    size_t head = 0;
+
+    while ( head != SIZE_MAX ) {
+        blocks[ head ].live = true;
+        chains--;
+
+        size_t last = head;
+        for ( ;; last++ ) {
+            for ( size_t i = blocks[ last ].begin; i < blocks[ last ].end; i++ ) order[ n++ ] = i;
+
+            if ( !blocks[ last ].falls || last + 1 == blocks_count ) break;
+        }
+
+        OptInstr_t* jump   = instrs + blocks[ last ].end - 1;
+        size_t      target = blocks[ last ].jump;
+
+        bool is_head = target < blocks_count && ( target == 0 || !blocks[ target - 1 ].falls );
+
+        if ( jump->code == JMP_CMD && is_head && !blocks[ target ].live && ( target != pinned || chains == 1 ) ) {
+            jump->size = 0;
+            stats->laid_out++;
+            head = target;
+            continue;
+        }
+
+        while ( scan < blocks_count && ( blocks[ scan ].live || ( scan > 0 && blocks[ scan - 1 ].falls ) ) ) scan++;
+        head = ( scan < blocks_count ) ? scan : SIZE_MAX;
+    }
+
+    free( blocks );
+
+    return order;
+}
+
+// Удаляет из таблицы метки, на которые не ведет ни один оставшийся переход
+static void RemoveUnusedLabels( Assembler_t* assembler, const OptInstr_t* instrs, size_t count, size_t words,
+                                OptStats_t* stats ) {
+    bool* referenced = ( bool* ) calloc ( words + 1, sizeof( *referenced ) );
+    assert( referenced && "Memory allocation error \n" );
+
+    for ( size_t i = 0; i < count; i++ ) {
+        int target = instrs[i].arg;
+
+        if ( instrs[i].size > 0 && IsJump( instrs[i].code ) && target >= 0 && ( size_t ) target <= words ) {
+            referenced[ target ] = true;
+        }
+    }
+
+    LabelTable_t* labels = &( assembler->labels );
+    for ( size_t i = 0; i < labels->capacity; i++ ) {
+        Label_t* label = labels->slots + i;
+
+        if ( label->name && ( label->address < 0 || ( size_t ) label->address > words || !referenced[ label->address ] ) ) {
+            label->address = -1;
+        }
+    }
+
+    stats->labels += LabelTableCompact( labels );
+
+    free( referenced );
+}
+
+size_t OptimizeByteCode( Assembler_t* assembler ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
+
+    PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ )
+
+    int    level = assembler->options.optimize;
+    size_t words = assembler->instruction_cnt;
+    size_t count = 0;
+
+    OptInstr_t* instrs   = DecodeProgram( assembler, &count );
+    size_t*     index_of = IndexByAddress( instrs, count, words );
+
+    OptStats_t stats = {};
+    size_t before = count;
+
+    MarkTargets( instrs, count, index_of, words );
+    ThreadJumps( instrs, count, index_of, words, &stats );
+
+    count = Peephole( instrs, count, &stats );
+    if ( level >= 2 ) count = RemoveUnreachable( instrs, count, &stats );
+    count = RemoveJumpsToNext( instrs, count, &stats );
+
+    size_t* order = NULL;
+    if ( level >= 2 ) {
+        order = LayoutBlocks( instrs, count, &stats );
+        RemoveUnusedLabels( assembler, instrs, count, words, &stats );
+    }
+    else {
+        order = ( size_t* ) calloc ( count + 1, sizeof( *order ) );
+        assert( order && "Memory allocation error \n" );
+
+        for ( size_t i = 0; i < count; i++ ) order[i] = i;
+    }
+
+    // Новый адрес каждой оставшейся инструкции по порядку выдачи; у невыдаваемого JMP - адрес следующей за ним
+    size_t* position  = ( size_t* ) calloc ( count + 1, sizeof( *position ) );
+    assert( position && "Memory allocation error \n" );
+
+    size_t new_words = 0;
+    size_t emitted   = 0;
+    for ( size_t k = 0; k < count; k++ ) {
+        position[ order[k] ] = new_words;
+        new_words += instrs[ order[k] ].size;
+        emitted   += ( instrs[ order[k] ].size > 0 );
+    }
+    position[ count ] = new_words;
+
+    // Новый адрес для каждого старого: удаленная инструкция переходит к следующей оставшейся
+    size_t* new_address = index_of;
+    size_t  next        = 0;
+
+    for ( size_t address = 0; address <= words; address++ ) {
+        while ( next < count && instrs[ next ].address < address ) next++;
+
+        new_address[ address ] = position[ next ];
+    }
+
+    size_t word = 0;
+    for ( size_t k = 0; k < count; k++ ) {
+        const OptInstr_t* instr = instrs + order[k];
+        if ( instr->size == 0 ) continue;
+
+        assembler->byte_code[ word++ ] = instr->code;
+        if ( instr->size < 2 ) continue;
+
+        int arg = instr->arg;
+        if ( IsJump( instr->code ) && arg >= 0 && ( size_t ) arg <= words ) {
+            arg = ( int ) new_address[ arg ];
+        }
+
+        assembler->byte_code[ word++ ] = arg;
+    }
+
+    assembler->instruction_cnt = word;
+
+    LabelTable_t* labels = &( assembler->labels );
+    for ( size_t i = 0; i < labels->capacity; i++ ) {
+        Label_t* label = labels->slots + i;
+
+        if ( label->name && label->address >= 0 && ( size_t ) label->address <= words ) {
+            label->address = ( int ) new_address[ label->address ];
+        }
+    }
+
+    if ( assembler->options.stats ) {
+        fprintf( stderr, "Optimizer: instructions %lu -> %lu ( removed %lu ), words %lu -> %lu; "
+                         "folded %lu, removed pairs %lu, threaded %lu, removed jumps %lu \n",
+                 before, emitted, before - emitted, words, word, stats.folded, stats.removed, stats.threaded, stats.jumps );
+    }
+
+    if ( assembler->options.stats && level >= 2 ) {
+        fprintf( stderr, "Control flow: blocks %lu, unreachable %lu ( instructions %lu ), "
+                         "jumps removed by layout %lu, unused labels %lu \n",
+                 stats.blocks, stats.dead, stats.dead_instrs, stats.laid_out, stats.labels );
+    }
+
+    free( position );
+    free( order );
+    free( index_of );
+    free( instrs );
+
+    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
+
+    return before - emitted;
+}
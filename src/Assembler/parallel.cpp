@@ -0,0 +1,184 @@
+// _ASM для glibc означает исходник на ассемблере и прячет типы setjmp, нужные pthread.h
+#undef _ASM
+#include <pthread.h>
+#define _ASM
+
+#include "assembler.h"
+
+// Параллельное ассемблирование ( -j N ): исходник делится по индексу строк на части, каждая часть
+// разбирается в своем потоке в собственные byte_code, таблицу меток и fixups. Внутри части все ссылки
+// на метки откладываются ( defer_labels ). Затем части склеиваются: адрес части - префиксная сумма
+// размеров предыдущих, метки переносятся в общую таблицу со сдвигом, ссылки разрешает ResolveFixups.
+// Байт-код совпадает с последовательным ассемблером.
+
+const size_t ASM_MIN_CHUNK_LINES = 256;  // Меньшие части не окупают запуск потока
+
+struct AsmChunk_t {
+    Assembler_t assembler  = {};           // asm_file.address общий и части не принадлежит
+    const char* begin      = NULL;
+    const char* end        = NULL;
+    size_t      first_line = 1;
+    size_t      base       = 0;            // Адрес первого слова части в общем байт-коде
+    int         result     = FAIL_RESULT;
+    bool        has_hlt    = false;
+};
+
+static void* TranslateChunk( void* argument ) {
+    AsmChunk_t*  chunk     = ( AsmChunk_t* ) argument;
+    Assembler_t* assembler = &( chunk->assembler );
+
+    LabelTableCtor( &( assembler->labels ) );
+
+    Lexer_t lexer = {};
+    LexerCtor( &lexer, chunk->begin, ( size_t ) ( chunk->end - chunk->begin ) );
+    lexer.line = chunk->first_line;
+
+    chunk->result = TranslateLines( assembler, &lexer, &( chunk->has_hlt ) );
+
+    return NULL;
+}
+
+// Каждая часть в своем потоке; если поток не создался - в текущем
+static void TranslateChunks( AsmChunk_t* chunks, size_t chunks_count ) {
+    pthread_t* threads = ( pthread_t* ) calloc ( chunks_count, sizeof( *threads ) );
+    bool*      started = ( bool*      ) calloc ( chunks_count, sizeof( *started ) );
+    assert( threads && started && "Memory allocation error \n" );
+
+    for ( size_t i = 0; i < chunks_count; i++ ) {
+        started[i] = ( pthread_create( threads + i, NULL, TranslateChunk, chunks + i ) == 0 );
+        if ( !started[i] ) TranslateChunk( chunks + i );
+    }
+
+    for ( size_t i = 0; i < chunks_count; i++ ) {
+        if ( started[i] ) pthread_join( threads[i], NULL );
+    }
+
+    free( started );
+    free( threads );
+}
+
+// Части - равные по числу строк отрезки индекса, так что номер первой строки части известен сразу
+static void SplitIntoChunks( AsmChunk_t* chunks, size_t chunks_count, const Assembler_t* assembler,
+                             const TextFile_t* source ) {
+    const char* end = source->text + source->size;
+
+    for ( size_t i = 0; i < chunks_count; i++ ) {
+        size_t first = source->lines_count * i       / chunks_count;
+        size_t next  = source->lines_count * ( i + 1 ) / chunks_count;
+
+        chunks[i] = {};
+        chunks[i].assembler.asm_file     = assembler->asm_file;
+        chunks[i].assembler.defer_labels = true;
+        chunks[i].begin      = source->lines[ first ].ptr;
+        chunks[i].end        = ( next < source->lines_count ) ? source->lines[ next ].ptr : end;
+        chunks[i].first_line = first + 1;
+    }
+}
+
+static void AppendFixups( Assembler_t* assembler, const Assembler_t* part, size_t base ) {
+    for ( size_t i = 0; i < part->fixups_count; i++ ) {
+        const Fixup_t* fixup = part->fixups + i;
+
+        AddFixup( assembler, fixup->name, fixup->length, fixup->word + base, fixup->line, fixup->source, fixup->command );
+    }
+}
+
+// Метка, объявленная в двух частях, обнаруживается только при склейке;
+// ее объявление находится повторным разбором части
+static void PrintLabelPosition( const Assembler_t* assembler, const AsmChunk_t* chunk, const Label_t* label ) {
+    Lexer_t lexer = {};
+    LexerCtor( &lexer, chunk->begin, ( size_t ) ( chunk->end - chunk->begin ) );
+    lexer.line = chunk->first_line;
+
+    Token_t token = {};
+    do {
+        if ( LexToken( &lexer, &token ) && token.type == TOKEN_LABEL && token.len - 1 == label->length &&
+             memcmp( token.ptr + 1, label->name, label->length ) == 0 ) {
+            fprintf( stderr, COLOR_BRIGHT_RED "  in file: %s:%lu:%lu \n", assembler->asm_file.address, token.line, token.column );
+            return;
+        }
+    } while ( LexNextLine( &lexer ) );
+}
+
+static int AppendLabels( Assembler_t* assembler, const AsmChunk_t* chunk ) {
+    const LabelTable_t* table = &( chunk->assembler.labels );
+
+    for ( size_t i = 0; i < table->capacity; i++ ) {
+        const Label_t* label = table->slots + i;
+        if ( !label->name ) continue;
+
+        if ( AddLabel( assembler, label->name, label->length, label->address + ( int ) chunk->base ) != SUCCESS_RESULT ) {
+            PrintLabelPosition( assembler, chunk, label );
+            return FAIL_RESULT;
+        }
+    }
+
+    return SUCCESS_RESULT;
+}
+
+int TranslateAsmParallel( Assembler_t* assembler, const TextFile_t* source ) {
+    my_assert( assembler, ASSERT_ERR_NULL_PTR );
+    my_assert( source,    ASSERT_ERR_NULL_PTR );
+
+    if ( source->lines_count < ASM_MIN_CHUNK_LINES * 2 ) {
+        return TranslateAsmToByteCode( assembler, source->text, source->size );
+    }
+
+    PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ )
+
+    size_t chunks_count = source->lines_count / ASM_MIN_CHUNK_LINES;
+    if ( chunks_count > assembler->options.threads ) chunks_count = assembler->options.threads;
+
+    AsmChunk_t* chunks = ( AsmChunk_t* ) calloc ( chunks_count, sizeof( *chunks ) );
+    assert( chunks && "Memory allocation error \n" );
+
+    SplitIntoChunks( chunks, chunks_count, assembler, source );
+
+    TranslateChunks( chunks, chunks_count );
+
+    int  result  = SUCCESS_RESULT;
+    bool has_hlt = false;
+    size_t base  = 0;
+
+    for ( size_t i = 0; i < chunks_count; i++ ) {
+        if ( chunks[i].result != SUCCESS_RESULT ) result = FAIL_RESULT;
+
+        has_hlt        = has_hlt || chunks[i].has_hlt;
+        chunks[i].base = base;
+        base          += chunks[i].assembler.instruction_cnt;
+    }
+
+    if ( result == SUCCESS_RESULT ) ReserveByteCode( assembler, base );
+
+    for ( size_t i = 0; i < chunks_count && result == SUCCESS_RESULT; i++ ) {
+        const Assembler_t* part = &( chunks[i].assembler );
+
+        if ( part->instruction_cnt > 0 ) {
+            memcpy( assembler->byte_code + chunks[i].base, part->byte_code, part->instruction_cnt * sizeof( int ) );
+        }
+
+        result = AppendLabels( assembler, chunks + i );
+        AppendFixups( assembler, part, chunks[i].base );
+    }
+
+    assembler->instruction_cnt = base;
+
+    for ( size_t i = 0; i < chunks_count; i++ ) {
+        Assembler_t* part = &( chunks[i].assembler );
+
+        free( part->byte_code );
+        free( part->fixups );
+        LabelTableDtor( &( part->labels ) );
+    }
+
+    free( chunks );
+
+    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
+
+    if ( result != SUCCESS_RESULT ) return FAIL_RESULT;
+
+    if ( has_hlt ) return SUCCESS_RESULT;
+
+    fprintf( stderr, COLOR_BRIGHT_RED "There is no HLT command \n" COLOR_RESET );
+    return FAIL_RESULT;
+}
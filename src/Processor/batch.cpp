@@ -0,0 +1,266 @@
+#include <pthread.h>
+#include <time.h>
+
+#include "processor.h"
+
+// Пакетный режим ( -b manifest ): байт-код загружается и декодируется один раз ( JIT компилирует
+// его один раз на поток ), затем пул потоков исполняет независимые экземпляры Processor_t - у каждого свои стеки, regs, RAM
+// и потоки IN/OUT. Каждая строка манифеста - "input_path [output_path]", по умолчанию
+// вывод пишется в input_path.out. Комментарии после ';' и пустые строки пропускаются.
+
+const int BATCH_NOT_RUN = -1;  // Не удалось открыть файлы запуска
+
+struct BatchJob_t {
+    char*  input_path  = NULL;
+    char*  output_path = NULL;
+    int    result      = BATCH_NOT_RUN;
+    size_t executed    = 0;
+    double time        = 0;
+};
+
+struct Batch_t {
+    const Processor_t* image       = NULL;  // Загруженная программа: код, начальная RAM, точка входа
+    const Options_t*   options     = NULL;
+    ProcEngine_t       engine      = NULL;
+
+    BatchJob_t*        jobs        = NULL;
+    size_t             jobs_count  = 0;
+    size_t             next_job    = 0;     // Раздается потокам атомарно
+};
+
+static double BatchSecondsNow() {
+    timespec now = {};
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( double ) now.tv_sec + ( double ) now.tv_nsec * 1e-9;
+}
+
+static char* CopyToken( const char* begin, const char* end, const char* suffix ) {
+    size_t length = ( size_t ) ( end - begin );
+    size_t suffix_length = strlen( suffix );
+
+    char* token = ( char* ) calloc ( length + suffix_length + 1, sizeof( *token ) );
+    assert( token && "Memory allocation error \n" );
+
+    memcpy( token, begin, length );
+    memcpy( token + length, suffix, suffix_length );
+
+    return token;
+}
+
+static const char* SkipBlank( const char* ptr, const char* end ) {
+    while ( ptr < end && isspace( ( unsigned char ) *ptr ) ) ptr++;
+
+    return ptr;
+}
+
+static const char* SkipToken( const char* ptr, const char* end ) {
+    while ( ptr < end && !isspace( ( unsigned char ) *ptr ) ) ptr++;
+
+    return ptr;
+}
+
+static bool ReadManifest( Batch_t* batch, const char* manifest_path ) {
+    FileStat manifest = {};
+    manifest.address = strdup( manifest_path );
+
+    TextFile_t text = {};
+    if ( !MapTextFile( &manifest, &text ) || text.size == 0 ) {
+        fprintf( stderr, COLOR_RED "Batch manifest \"%s\" is empty or missing \n" COLOR_RESET, manifest_path );
+        UnmapTextFile( &text );
+        free( manifest.address );
+        return false;
+    }
+
+    size_t lines_count = IndexLines( &text );
+
+    batch->jobs = ( BatchJob_t* ) calloc ( lines_count, sizeof( *batch->jobs ) );
+    assert( batch->jobs && "Memory allocation error \n" );
+
+    for ( size_t i = 0; i < lines_count; i++ ) {
+        const char* line_end = text.lines[i].ptr + text.lines[i].len;
+
+        const char* input_begin  = SkipBlank( text.lines[i].ptr, line_end );
+        const char* input_end    = SkipToken( input_begin,       line_end );
+        if ( input_begin == input_end ) continue;
+
+        const char* output_begin = SkipBlank( input_end,    line_end );
+        const char* output_end   = SkipToken( output_begin, line_end );
+
+        BatchJob_t* job = batch->jobs + batch->jobs_count++;
+        *job = {};
+        job->input_path  = CopyToken( input_begin, input_end, "" );
+        job->output_path = ( output_begin != output_end ) ? CopyToken( output_begin, output_end, ""     )
+                                                          : CopyToken( input_begin,  input_end,  ".out" );
+    }
+
+    UnmapTextFile( &text );
+    free( manifest.address );
+
+    return true;
+}
+
+// Машинный код JIT ( program ) общий для всех запусков потока, как и code
+static void RunJob( const Batch_t* batch, BatchJob_t* job, Instr_t* code, ProcEngine_t engine, const JitProgram_t* program ) {
+    const Processor_t* image = batch->image;
+
+    FILE* in  = fopen( job->input_path,  "r" );
+    FILE* out = fopen( job->output_path, "w" );
+
+    if ( !in || !out ) {
+        fprintf( stderr, COLOR_RED "Batch: cannot open \"%s\" or \"%s\" \n" COLOR_RESET, job->input_path, job->output_path );
+        if ( in  ) fclose( in  );
+        if ( out ) fclose( out );
+        return;
+    }
+
+    Processor_t processor = {};
+    ProcCtor( &processor, batch->options->stack_size, batch->options->refund_stack_size, image->ram_size );
+    processor.stk.never_shrink        = batch->options->never_shrink;
+    processor.refund_stk.never_shrink = batch->options->never_shrink;
+
+    // Код общий для всех запусков потока, владеет им RunWorker
+    // Копируется только начальное содержимое из файла: остальная RAM и так нулевая и не занимает страниц
+    memcpy( processor.RAM, image->RAM, image->ram_loaded * sizeof( *processor.RAM ) );
+    processor.ram_loaded        = image->ram_loaded;
+    processor.code              = code;
+    processor.code_size         = image->code_size;
+    processor.instruction_count = image->instruction_count;
+    processor.instruction_ptr   = image->instruction_ptr;
+    processor.in                = in;
+    processor.out               = out;
+    processor.verified          = image->verified;
+    processor.fast              = image->fast;
+    processor.max_stack_depth   = image->max_stack_depth;
+
+    if ( processor.fast ) {
+        ReserveVerifiedStack( &processor );
+    }
+
+    // Образ RAM каждый запуск отображает сам, без копирования ( в пакете - всегда копирование при записи )
+    if ( image->ram_image_fd >= 0 &&
+         MapRamImage( &processor, image->ram_image_fd, image->ram_image_size, image->ram_image_mode ) != SUCCESS ) {
+        job->result = 1;
+        processor.code = NULL;
+        ProcDtor( &processor );
+        fclose( in );
+        fclose( out );
+        return;
+    }
+
+    double start_time = BatchSecondsNow();
+    job->result   = ( program ) ? JitExecute( program, &processor ) : engine( &processor );
+    job->time     = BatchSecondsNow() - start_time;
+    job->executed = processor.executed_count;
+
+    processor.code = NULL;
+    ProcDtor( &processor );
+
+    fclose( in );
+    fclose( out );
+}
+
+static void* RunWorker( void* argument ) {
+    Batch_t* batch = ( Batch_t* ) argument;
+
+    // Своя копия декодированного потока: шитый движок записывает в неё адреса обработчиков
+    size_t code_bytes = ( batch->image->code_size + 1 ) * sizeof( Instr_t );
+    Instr_t* code = ( Instr_t* ) malloc ( code_bytes );
+    assert( code && "Memory allocation error \n" );
+    memcpy( code, batch->image->code, code_bytes );
+
+    // JIT компилирует свою копию один раз: код ссылается на инструкции code, но не на Processor_t запуска
+    ProcEngine_t  engine  = batch->engine;
+    JitProgram_t* program = NULL;
+    if ( batch->options->engine == ENGINE_JIT ) {
+        program = JitCompile( code, batch->image->code_size, batch->image->ram_size, batch->image->fast );
+        if ( program == NULL ) engine = ByteCodeProcessing;
+    }
+
+    for ( ;; ) {
+        size_t index = __atomic_fetch_add( &( batch->next_job ), 1, __ATOMIC_RELAXED );
+        if ( index >= batch->jobs_count ) break;
+
+        RunJob( batch, batch->jobs + index, code, engine, program );
+    }
+
+    JitRelease( program );
+    free( code );
+
+    return NULL;
+}
+
+int ByteCodeProcessingBatch( const Processor_t* image, const Options_t* options, ProcEngine_t engine ) {
+    my_assert( image,   ASSERT_ERR_NULL_PTR )
+    my_assert( options, ASSERT_ERR_NULL_PTR )
+    my_assert( engine,  ASSERT_ERR_NULL_PTR )
+
+    PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ );
+
+    Batch_t batch = {};
+    batch.image   = image;
+    batch.options = options;
+    batch.engine  = engine;
+
+    if ( !ReadManifest( &batch, options->batch_manifest ) ) {
+        return 1;
+    }
+
+    size_t threads_count = options->threads;
+    if ( threads_count == 0 ) {
+        long online = sysconf( _SC_NPROCESSORS_ONLN );
+        threads_count = ( online > 0 ) ? ( size_t ) online : 1;
+    }
+    if ( threads_count > batch.jobs_count ) {
+        threads_count = ( batch.jobs_count > 0 ) ? batch.jobs_count : 1;
+    }
+
+    pthread_t* threads = ( pthread_t* ) calloc ( threads_count, sizeof( *threads ) );
+    assert( threads && "Memory allocation error \n" );
+
+    double start_time = BatchSecondsNow();
+
+    size_t started = 0;
+    for ( ; started < threads_count; started++ ) {
+        if ( pthread_create( threads + started, NULL, RunWorker, &batch ) != 0 ) {
+            break;
+        }
+    }
+
+    if ( started == 0 ) {
+        RunWorker( &batch );  // Потоки недоступны - исполняем все запуски в текущем
+    }
+
+    for ( size_t i = 0; i < started; i++ ) {
+        pthread_join( threads[i], NULL );
+    }
+
+    double run_time = BatchSecondsNow() - start_time;
+
+    size_t failed   = 0;
+    size_t executed = 0;
+    for ( size_t i = 0; i < batch.jobs_count; i++ ) {
+        const BatchJob_t* job = batch.jobs + i;
+
+        if ( job->result != 0 ) failed++;
+        executed += job->executed;
+
+        if ( options->stats ) {
+            fprintf( stderr, "Batch: %s -> %s; result = %d; executed = %lu instructions; time = %.6f s \n",
+                     job->input_path, job->output_path, job->result, job->executed, job->time );
+        }
+
+        free( job->input_path );
+        free( job->output_path );
+    }
+
+    fprintf( stderr, "Batch: runs = %lu; failed = %lu; threads = %lu; executed = %lu instructions; time = %.6f s \n",
+             batch.jobs_count, failed, ( started > 0 ) ? started : 1, executed, run_time );
+
+    free( threads );
+    free( batch.jobs );
+
+    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
+
+    return ( failed == 0 ) ? 0 : 1;
+}
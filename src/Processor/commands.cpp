@@ -1,19 +1,19 @@
 #include "processor.h"
 
 
-void ProcPush( Processor_t* processor) {
+void ProcPush( Processor_t* processor, const Instr_t* instr ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
-    StackPush( &( processor->stk ), processor->byte_code[ processor->instruction_ptr++ ] );
+    StackPush( &( processor->stk ), instr->imm );
 }
 
-void ProcPop( Processor_t* processor) {
+void ProcPop( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     StackPop( &( processor->stk ) );
 }
 
-void ProcAdd( Processor_t* processor ) {
+void ProcAdd( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     int a = StackTop( &( processor->stk ) );
@@ -24,7 +24,7 @@ void ProcAdd( Processor_t* processor ) {
     StackPush( &( processor->stk ), a + b );
 }
 
-void ProcSub( Processor_t* processor ) {
+void ProcSub( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     int b = StackTop( &( processor->stk ) );
@@ -35,7 +35,7 @@ void ProcSub( Processor_t* processor ) {
     StackPush( &( processor->stk ), a - b );
 }
 
-void ProcMul( Processor_t* processor ) {
+void ProcMul( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     int a = StackTop( &( processor->stk ) );
@@ -46,7 +46,7 @@ void ProcMul( Processor_t* processor ) {
     StackPush( &( processor->stk ), a * b );
 }
 
-void ProcDiv( Processor_t* processor ) {
+void ProcDiv( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     int b   = StackTop( &( processor->stk ) );
@@ -59,7 +59,7 @@ void ProcDiv( Processor_t* processor ) {
     StackPush( &( processor->stk ), a / b );
 }
 
-void ProcPow( Processor_t* processor ) {
+void ProcPow( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     int indicator = StackTop( &( processor->stk ) );
@@ -76,7 +76,7 @@ void ProcPow( Processor_t* processor ) {
     StackPush( &( processor->stk ), result );
 }
 
-void ProcSqrt( Processor_t* processor ) {
+void ProcSqrt( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     int a = StackTop( &( processor->stk ) );
@@ -84,144 +84,301 @@ void ProcSqrt( Processor_t* processor ) {
     StackPush( &( processor->stk ), ( int ) sqrt( a ) );
 }
 
-void ProcIn( Processor_t* processor ) {
+void ProcIn( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     int number = 0;
 
-    fprintf( stderr, "Input a number: " );
-    scanf( "%d", &number );
+    fprintf( processor->out, "Input a number: " );
+    fscanf( processor->in, "%d", &number );
 
     StackPush( &( processor->stk ), number );
 }
 
-void ProcOut( Processor_t* processor ) {
+void ProcOut( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     int n = StackTop( &( processor->stk ) );
     StackPop( &( processor->stk ) );
 
-    fprintf( stderr, "Output: %d \n", n );
+    fprintf( processor->out, "Output: %d \n", n );
 }
 
-void ProcPushR( Processor_t* processor ) {
+void ProcPushR( Processor_t* processor, const Instr_t* instr ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
-    StackPush( &( processor->stk ), processor->regs[ processor->byte_code[ processor->instruction_ptr++ ] ] );
+    StackPush( &( processor->stk ), processor->regs[ instr->reg ] );
 }
 
-void ProcPopR( Processor_t* processor ) {
+void ProcPopR( Processor_t* processor, const Instr_t* instr ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
-    processor->regs[ processor->byte_code[ processor->instruction_ptr++ ] ] = StackTop( &( processor->stk ) );
+    processor->regs[ instr->reg ] = StackTop( &( processor->stk ) );
     StackPop( &( processor->stk ) );
 }
 
-void ProcPushM( Processor_t* processor ) {
-    my_assert( processor, ASSERT_ERR_NULL_PTR );
-    my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
-
-    // PUSHM [register] или PUSHM address
-    // Вытаскиваем значение из RAM по индексу из регистра или прямому адресу
-    // байт-код: [PUSHM_CMD, reg_index_or_address]
-    int reg_index = processor->byte_code[ processor->instruction_ptr++ ];
-    
-    int ram_index;
-    
-    // Если значение < 100, считаем что это регистр (0-3)
-    // Если >= 100, считаем что это прямой адрес в RAM
-    if ( reg_index < REGS_NUMBER ) {
-        // Используем регистр
-        ram_index = processor->regs[reg_index];
-    } else {
-        // Прямой адрес
-        ram_index = reg_index - 100;  // смещение для различения
-    }
-    
-    if ( ram_index < 0 || ram_index >= RAM_SIZE ) {
+static void CheckRamIndex( const Processor_t* processor, int ram_index ) {
+    if ( ram_index < 0 || ( size_t ) ram_index >= processor->ram_size ) {
         fprintf( stderr, COLOR_RED "RAM index out of bounds: %d" COLOR_RESET "\n", ram_index );
         assert( 0 && "RAM access violation" );
     }
-    
-    StackPush( &( processor->stk ), processor->RAM[ram_index] );
 }
 
-void ProcPopM( Processor_t* processor ) {
+void ProcPushM( Processor_t* processor, const Instr_t* instr ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
     my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
 
-    // POPM [register] или POPM address
-    // Кладем значение из стека в RAM по индексу из регистра или прямому адресу
-    // байт-код: [POPM_CMD, reg_index_or_address]
-    int reg_index = processor->byte_code[ processor->instruction_ptr++ ];
-    
-    int ram_index;
-    
-    // Если значение < 100, считаем что это регистр (0-3)
-    // Если >= 100, считаем что это прямой адрес в RAM
-    if ( reg_index < REGS_NUMBER ) {
-        // Используем регистр
-        ram_index = processor->regs[reg_index];
-    } else {
-        // Прямой адрес (вычитаем 100 для получения реального адреса)
-        ram_index = reg_index - 100;
-    }
-    
-    if ( ram_index < 0 || ram_index >= RAM_SIZE ) {
-        fprintf( stderr, COLOR_RED "RAM index out of bounds: %d" COLOR_RESET "\n", ram_index );
-        assert( 0 && "RAM access violation" );
-    }
-    
+    // PUSHM [register]: вытаскиваем значение из RAM по индексу из регистра
+    int ram_index = processor->regs[ instr->reg ];
+    CheckRamIndex( processor, ram_index );
+
+    StackPush( &( processor->stk ), processor->RAM[ ram_index ] );
+}
+
+void ProcPopM( Processor_t* processor, const Instr_t* instr ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+    my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
+
+    // POPM [register]: кладем значение из стека в RAM по индексу из регистра
+    int ram_index = processor->regs[ instr->reg ];
+    CheckRamIndex( processor, ram_index );
+
+    processor->RAM[ ram_index ] = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+}
+
+void ProcPushMAbs( Processor_t* processor, const Instr_t* instr ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+    my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
+
+    CheckRamIndex( processor, instr->addr );
+
+    StackPush( &( processor->stk ), processor->RAM[ instr->addr ] );
+}
+
+void ProcPopMAbs( Processor_t* processor, const Instr_t* instr ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+    my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
+
+    CheckRamIndex( processor, instr->addr );
+
+    processor->RAM[ instr->addr ] = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+}
+
+void ProcMemset( Processor_t* processor, const Instr_t* ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+    my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
+
+    int count = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
     int value = StackTop( &( processor->stk ) );
     StackPop( &( processor->stk ) );
-    
-    processor->RAM[ram_index] = value;
+    int dst = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+
+    CheckRamRange( processor->ram_size, dst, count );
+
+    RamFill( processor->RAM + dst, value, ( size_t ) count );
 }
 
-void ProcJump( Processor_t* processor ) {
+void ProcMemcpy( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
+    my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
+
+    int count = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+    int src = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+    int dst = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
 
-    int command = processor->byte_code[ processor->instruction_ptr - 1 ];
-    size_t index = ( size_t ) processor->byte_code[ processor->instruction_ptr++ ];
+    CheckRamRange( processor->ram_size, src, count );
+    CheckRamRange( processor->ram_size, dst, count );
 
-    if ( command == JMP_CMD ) {
-        processor->instruction_ptr = index;
-        return;
-    }
+    RamCopy( processor->RAM + dst, processor->RAM + src, ( size_t ) count );
+}
 
+void ProcMemcmp( Processor_t* processor, const Instr_t* ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+    my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
+
+    int count = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
     int b = StackTop( &( processor->stk ) );
     StackPop( &( processor->stk ) );
     int a = StackTop( &( processor->stk ) );
     StackPop( &( processor->stk ) );
 
-    if ( command == JB_CMD && a < b ) {
-        processor->instruction_ptr = index;
-    }
-    else if ( command == JA_CMD && a > b) {
-        processor->instruction_ptr = index;
-    }
-    else if ( command == JBE_CMD && a <= b) {
-        processor->instruction_ptr = index;
-    }
-    else if ( command == JAE_CMD && a >= b) {
-        processor->instruction_ptr = index;
-    }
-    else if ( command == JE_CMD && a == b ) {
-        processor->instruction_ptr = index;
+    CheckRamRange( processor->ram_size, a, count );
+    CheckRamRange( processor->ram_size, b, count );
+
+    StackPush( &( processor->stk ), RamCompare( processor->RAM + a, processor->RAM + b, ( size_t ) count ) );
+}
+
+// VADD, VMUL: снимаем len, b, a, dst; границы всех трех диапазонов проверяются до вычислений
+#define DEF_VECTOR_BINARY( name, kernel )                                      \
+    void name( Processor_t* processor, const Instr_t* ) {                      \
+        my_assert( processor, ASSERT_ERR_NULL_PTR );                           \
+        my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );                      \
+                                                                               \
+        int len = StackTop( &( processor->stk ) );                             \
+        StackPop( &( processor->stk ) );                                       \
+        int b = StackTop( &( processor->stk ) );                               \
+        StackPop( &( processor->stk ) );                                       \
+        int a = StackTop( &( processor->stk ) );                               \
+        StackPop( &( processor->stk ) );                                       \
+        int dst = StackTop( &( processor->stk ) );                             \
+        StackPop( &( processor->stk ) );                                       \
+                                                                               \
+        CheckRamRange( processor->ram_size, a,   len );                        \
+        CheckRamRange( processor->ram_size, b,   len );                        \
+        CheckRamRange( processor->ram_size, dst, len );                        \
+                                                                               \
+        kernel( processor->RAM + dst, processor->RAM + a, processor->RAM + b, ( size_t ) len ); \
     }
+
+DEF_VECTOR_BINARY( ProcVadd, RamVectorAdd )
+DEF_VECTOR_BINARY( ProcVmul, RamVectorMul )
+
+#undef DEF_VECTOR_BINARY
+
+void ProcVsum( Processor_t* processor, const Instr_t* ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+    my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
+
+    int len = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+    int a = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+
+    CheckRamRange( processor->ram_size, a, len );
+
+    StackPush( &( processor->stk ), RamVectorSum( processor->RAM + a, ( size_t ) len ) );
 }
 
-void ProcCall( Processor_t* processor ) {
+void ProcVdot( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
+    my_assert( processor->RAM, ASSERT_ERR_NULL_PTR );
+
+    int len = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+    int b = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+    int a = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+
+    CheckRamRange( processor->ram_size, a, len );
+    CheckRamRange( processor->ram_size, b, len );
+
+    StackPush( &( processor->stk ), RamVectorDot( processor->RAM + a, processor->RAM + b, ( size_t ) len ) );
+}
 
-    StackPush( &( processor->refund_stk ), ( int ) ( processor->instruction_ptr + 1 ) );
+void ProcJmp( Processor_t* processor, const Instr_t* instr ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
 
-    processor->instruction_ptr = ( size_t ) processor->byte_code[ processor->instruction_ptr ];
+    processor->instruction_ptr = instr->target;
 }
 
-void ProcRet( Processor_t* processor ) {
+// Условный переход: снимаем b, затем a и переходим, если выполнено условие
+#define DEF_CONDITIONAL_JUMP( name, condition )                    \
+    void name( Processor_t* processor, const Instr_t* instr ) {    \
+        my_assert( processor, ASSERT_ERR_NULL_PTR );               \
+                                                                   \
+        int b = StackTop( &( processor->stk ) );                   \
+        StackPop( &( processor->stk ) );                           \
+        int a = StackTop( &( processor->stk ) );                   \
+        StackPop( &( processor->stk ) );                           \
+                                                                   \
+        if ( condition ) {                                         \
+            processor->instruction_ptr = instr->target;            \
+        }                                                          \
+    }
+
+DEF_CONDITIONAL_JUMP( ProcJb,  a <  b )
+DEF_CONDITIONAL_JUMP( ProcJa,  a >  b )
+DEF_CONDITIONAL_JUMP( ProcJbe, a <= b )
+DEF_CONDITIONAL_JUMP( ProcJae, a >= b )
+DEF_CONDITIONAL_JUMP( ProcJe,  a == b )
+
+#undef DEF_CONDITIONAL_JUMP
+
+void ProcCall( Processor_t* processor, const Instr_t* instr ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    // instruction_ptr уже указывает на следующую инструкцию - это адрес возврата
+    StackPush( &( processor->refund_stk ), ( int ) processor->instruction_ptr );
+
+    processor->instruction_ptr = instr->target;
+}
+
+void ProcRet( Processor_t* processor, const Instr_t* ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     processor->instruction_ptr = ( size_t ) StackTop( &( processor->refund_stk ) );
     StackPop( &( processor->refund_stk ) );
-}
\ No newline at end of file
+}
+
+// Суперинструкции. Исходные инструкции остаются в потоке за слитой (на них могут вести переходы),
+// поэтому слитая инструкция перепрыгивает их сама.
+
+void ProcRegAddImm( Processor_t* processor, const Instr_t* instr ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    processor->regs[ instr->reg ] = processor->regs[ instr->reg ] + instr->imm;
+    processor->instruction_ptr += REG_ADD_IMM_LEN - 1;
+}
+
+#define DEF_CONDITIONAL_JUMP_REG_IMM( name, condition )            \
+    void name( Processor_t* processor, const Instr_t* instr ) {    \
+        my_assert( processor, ASSERT_ERR_NULL_PTR );               \
+                                                                   \
+        int a = processor->regs[ instr->reg ];                     \
+        int b = instr->imm;                                        \
+                                                                   \
+        if ( condition ) {                                         \
+            processor->instruction_ptr = instr->target;            \
+        } else {                                                   \
+            processor->instruction_ptr += JCC_REG_IMM_LEN - 1;     \
+        }                                                          \
+    }
+
+DEF_CONDITIONAL_JUMP_REG_IMM( ProcJbRegImm,  a <  b )
+DEF_CONDITIONAL_JUMP_REG_IMM( ProcJaRegImm,  a >  b )
+DEF_CONDITIONAL_JUMP_REG_IMM( ProcJbeRegImm, a <= b )
+DEF_CONDITIONAL_JUMP_REG_IMM( ProcJaeRegImm, a >= b )
+DEF_CONDITIONAL_JUMP_REG_IMM( ProcJeRegImm,  a == b )
+
+#undef DEF_CONDITIONAL_JUMP_REG_IMM
+
+// Адрес проверен при слиянии, поэтому проверок границ RAM здесь нет
+void ProcLoadConst( Processor_t* processor, const Instr_t* instr ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    processor->regs[ instr->reg ] = instr->addr;
+    StackPush( &( processor->stk ), processor->RAM[ instr->addr ] );
+    processor->instruction_ptr += CONST_RAM_LEN - 1;
+}
+
+void ProcStoreConst( Processor_t* processor, const Instr_t* instr ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    processor->regs[ instr->reg ] = instr->addr;
+    processor->RAM[ instr->addr ] = StackTop( &( processor->stk ) );
+    StackPop( &( processor->stk ) );
+    processor->instruction_ptr += CONST_RAM_LEN - 1;
+}
+
+// Таблица строится из OPCODES_TABLE в том же порядке, что и OPCODES: индексы совпадают
+#define DEF_CMD( name, code, operand, other_form, pops, pushes, handler ) \
+    { name##_CMD, handler, operand, ( operand == OPERAND_NONE ) ? 0u : 1u },
+
+const Command_t commands[] = {
+    OPCODES_TABLE( DEF_CMD )
+};
+
+#undef DEF_CMD
+
+static_assert( sizeof( commands ) / sizeof( *commands ) == OPCODES_COUNT, "commands[] must follow OPCODES" );
+
+const size_t commands_count = sizeof( commands ) / sizeof( *commands );
@@ -0,0 +1,111 @@
+#include "processor.h"
+
+// Слияние частых последовательностей инструкций в суперинструкции.
+// Суперинструкция записывается на место первой инструкции последовательности, остальные
+// инструкции остаются на своих местах: переходы в середину последовательности продолжают
+// работать, а сама суперинструкция перескакивает их.
+
+static int ConditionalJumpRegImm( int command ) {
+    switch ( command ) {
+        case JB_CMD:  return JB_REG_IMM_CMD;
+        case JA_CMD:  return JA_REG_IMM_CMD;
+        case JBE_CMD: return JBE_REG_IMM_CMD;
+        case JAE_CMD: return JAE_REG_IMM_CMD;
+        case JE_CMD:  return JE_REG_IMM_CMD;
+        default:      return 0;
+    }
+}
+
+static ProcHandler_t ConditionalJumpRegImmHandler( int command ) {
+    switch ( command ) {
+        case JB_REG_IMM_CMD:  return ProcJbRegImm;
+        case JA_REG_IMM_CMD:  return ProcJaRegImm;
+        case JBE_REG_IMM_CMD: return ProcJbeRegImm;
+        case JAE_REG_IMM_CMD: return ProcJaeRegImm;
+        case JE_REG_IMM_CMD:  return ProcJeRegImm;
+        default:              return NULL;
+    }
+}
+
+// PUSHR r; PUSH k; ADD/SUB; POPR r
+static bool FuseRegAddImm( Instr_t* instr, size_t rest ) {
+    if ( rest < REG_ADD_IMM_LEN
+         || instr[0].command != PUSHR_CMD || instr[1].command != PUSH_CMD
+         || ( instr[2].command != ADD_CMD && instr[2].command != SUB_CMD )
+         || instr[3].command != POPR_CMD  || instr[3].reg != instr[0].reg ) {
+        return false;
+    }
+
+    // r - k == r + ( -k ) по модулю 2^32
+    StackData_t imm = ( instr[2].command == ADD_CMD ) ? instr[1].imm
+                                                      : ( StackData_t ) ( 0u - ( unsigned ) instr[1].imm );
+
+    instr->command = REG_ADD_IMM_CMD;
+    instr->handler = ProcRegAddImm;
+    instr->imm     = imm;
+
+    return true;
+}
+
+// PUSHR r; PUSH k; Jcc :n
+static bool FuseJumpRegImm( Instr_t* instr, size_t rest ) {
+    if ( rest < JCC_REG_IMM_LEN
+         || instr[0].command != PUSHR_CMD || instr[1].command != PUSH_CMD
+         || ConditionalJumpRegImm( instr[2].command ) == 0 ) {
+        return false;
+    }
+
+    instr->command = ConditionalJumpRegImm( instr[2].command );
+    instr->handler = ConditionalJumpRegImmHandler( instr->command );
+    instr->imm     = instr[1].imm;
+    instr->target  = instr[2].target;
+
+    return true;
+}
+
+// PUSH n; POPR r; PUSHM [r]  или  PUSH n; POPR r; POPM [r]
+static bool FuseConstRam( Instr_t* instr, size_t rest, size_t ram_size ) {
+    if ( rest < CONST_RAM_LEN
+         || instr[0].command != PUSH_CMD || instr[1].command != POPR_CMD
+         || ( instr[2].command != PUSHM_CMD && instr[2].command != POPM_CMD )
+         || instr[2].reg != instr[1].reg ) {
+        return false;
+    }
+
+    // Адрес вне RAM оставляем обычным инструкциям - они выдадут ошибку при исполнении
+    if ( instr[0].imm < 0 || ( size_t ) instr[0].imm >= ram_size ) {
+        return false;
+    }
+
+    bool is_load = ( instr[2].command == PUSHM_CMD );
+
+    instr->command = is_load ? LOAD_CONST_CMD : STORE_CONST_CMD;
+    instr->handler = is_load ? ProcLoadConst  : ProcStoreConst;
+    instr->reg     = instr[1].reg;
+    instr->addr    = instr[0].imm;
+
+    return true;
+}
+
+size_t FuseInstructions( Processor_t* processor ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    Instr_t* code  = processor->code;
+    size_t   count = processor->code_size;
+    size_t   fused = 0;
+
+    // Идем вперед: инструкции после i еще не тронуты, и каждая из них может начать свою последовательность
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( FuseRegAddImm ( code + i, count - i ) ||
+             FuseJumpRegImm( code + i, count - i ) ||
+             FuseConstRam  ( code + i, count - i, processor->ram_size ) ) {
+            fused++;
+        }
+    }
+
+    processor->fused_count = fused;
+
+    PRINT( COLOR_BRIGHT_YELLOW "Fused %lu superinstructions \n", fused )
+
+    return fused;
+}
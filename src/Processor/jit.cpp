@@ -0,0 +1,690 @@
+#include <stddef.h>
+#include <sys/mman.h>
+
+#include "processor.h"
+
+// JIT-компилятор декодированного потока в машинный код x86-64.
+//
+// Раскладка регистров на время исполнения:
+//     rbx - Processor_t*          r12 - processor->regs
+//     r13 - processor->RAM        r14 - processor->stk.data
+//     r15 - processor->stk.size   rbp - счетчик исполненных инструкций
+// Все они callee-saved, поэтому переживают вызовы обработчиков Proc*.
+// Значения стека, регистров и RAM лежат в памяти, как и у интерпретатора.
+//
+// IN, OUT, POW, SQRT и медленные пути (деление на 0, выход за RAM, рост стека возврата)
+// вызывают обычные обработчики Proc*, после чего переход идет по processor->instruction_ptr
+// через таблицу адресов инструкций. Через эту же таблицу работает RET.
+
+const size_t JIT_EXIT = SIZE_MAX;  // Цель перехода "выход из функции"
+
+struct JitFixup_t {
+    size_t pos    = 0;  // Смещение rel32 в коде
+    size_t target = 0;  // Индекс инструкции или JIT_EXIT
+};
+
+struct Jit_t {
+    uint8_t*    bytes           = NULL;
+    size_t      size            = 0;
+    size_t      capacity        = 0;
+
+    size_t*     offsets         = NULL;  // Смещение кода каждой инструкции (code_size + 1)
+    size_t      exit_offset     = 0;
+
+    JitFixup_t* fixups          = NULL;
+    size_t      fixups_count    = 0;
+    size_t      fixups_capacity = 0;
+
+    const void** table          = NULL;  // Абсолютные адреса инструкций для RET и возврата из Proc*
+
+    size_t      ram_size        = 0;     // Граница для проверок адресов RAM
+    bool        fast            = false; // Программа проверена: стек уже на наибольшую глубину
+};
+
+typedef int ( *JitEntry_t )( Processor_t* processor, const void* start );
+
+#define STK_OFFSET( field )    ( int32_t ) ( offsetof( Processor_t, stk ) + offsetof( Stack_t, field ) )
+#define REFUND_OFFSET( field ) ( int32_t ) ( offsetof( Processor_t, refund_stk ) + offsetof( Stack_t, field ) )
+#define PROC_OFFSET( field )   ( int32_t ) offsetof( Processor_t, field )
+
+#define REG_OFFSET( reg )      ( ( reg ) * ( int ) sizeof( StackData_t ) )
+#define RAM_OFFSET( addr )     ( ( addr ) * ( int ) sizeof( int ) )
+
+// Коды условных переходов 0F 8x
+const uint8_t JCC_JB  = 0x82;
+const uint8_t JCC_JAE = 0x83;
+const uint8_t JCC_JE  = 0x84;
+const uint8_t JCC_JL  = 0x8C;
+const uint8_t JCC_JGE = 0x8D;
+const uint8_t JCC_JLE = 0x8E;
+const uint8_t JCC_JG  = 0x8F;
+
+//---------------------------------------------------------------------------------------------------------------
+// Запись байтов
+
+static void Emit1( Jit_t* jit, uint8_t byte ) {
+    if ( jit->size == jit->capacity ) {
+        jit->capacity = ( jit->capacity > 0 ) ? jit->capacity * 2 : 4096;
+        jit->bytes = ( uint8_t* ) realloc ( jit->bytes, jit->capacity );
+        assert( jit->bytes && "Memory allocation error \n" );
+    }
+
+    jit->bytes[ jit->size++ ] = byte;
+}
+
+static void EmitBytes( Jit_t* jit, const char* bytes, size_t count ) {
+    for ( size_t i = 0; i < count; i++ ) {
+        Emit1( jit, ( uint8_t ) bytes[i] );
+    }
+}
+
+static void Emit4( Jit_t* jit, int32_t value ) {
+    uint32_t bits = ( uint32_t ) value;
+    for ( int i = 0; i < 4; i++, bits >>= 8 ) {
+        Emit1( jit, ( uint8_t ) ( bits & 0xFF ) );
+    }
+}
+
+static void Emit8( Jit_t* jit, uint64_t value ) {
+    for ( int i = 0; i < 8; i++, value >>= 8 ) {
+        Emit1( jit, ( uint8_t ) ( value & 0xFF ) );
+    }
+}
+
+#define EMIT( jit, bytes ) EmitBytes( jit, bytes, sizeof( bytes ) - 1 )
+
+static void Patch4( Jit_t* jit, size_t pos, int32_t value ) {
+    uint32_t bits = ( uint32_t ) value;
+    for ( size_t i = 0; i < 4; i++, bits >>= 8 ) {
+        jit->bytes[ pos + i ] = ( uint8_t ) ( bits & 0xFF );
+    }
+}
+
+// rel32 по смещению pos указывает на текущую позицию
+static void PatchHere( Jit_t* jit, size_t pos ) {
+    Patch4( jit, pos, ( int32_t ) ( jit->size - ( pos + 4 ) ) );
+}
+
+static void AddFixup( Jit_t* jit, size_t target ) {
+    if ( jit->fixups_count == jit->fixups_capacity ) {
+        jit->fixups_capacity = ( jit->fixups_capacity > 0 ) ? jit->fixups_capacity * 2 : 256;
+        jit->fixups = ( JitFixup_t* ) realloc ( jit->fixups, jit->fixups_capacity * sizeof( *jit->fixups ) );
+        assert( jit->fixups && "Memory allocation error \n" );
+    }
+
+    jit->fixups[ jit->fixups_count ].pos    = jit->size;
+    jit->fixups[ jit->fixups_count ].target = target;
+    jit->fixups_count++;
+
+    Emit4( jit, 0 );
+}
+
+static void EmitJmp( Jit_t* jit, size_t target ) {
+    Emit1( jit, 0xE9 );                                    // jmp rel32
+    AddFixup( jit, target );
+}
+
+static void EmitJcc( Jit_t* jit, uint8_t condition, size_t target ) {
+    Emit1( jit, 0x0F ); Emit1( jit, condition );          // jcc rel32
+    AddFixup( jit, target );
+}
+
+// jcc вперед внутри инструкции, возвращает позицию rel32 для PatchHere
+static size_t EmitJccForward( Jit_t* jit, uint8_t condition ) {
+    Emit1( jit, 0x0F ); Emit1( jit, condition );
+    Emit4( jit, 0 );
+
+    return jit->size - 4;
+}
+
+static void EmitAddress( Jit_t* jit, const char* movabs, uintptr_t address ) {
+    EmitBytes( jit, movabs, 2 );
+    Emit8( jit, address );
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Операции со стеком и памятью
+
+static void EmitLoadB( Jit_t* jit )     { EMIT( jit, "\x43\x8B\x4C\xBE\xFC" ); }   // mov ecx, [r14 + r15*4 - 4]
+static void EmitLoadA( Jit_t* jit )     { EMIT( jit, "\x43\x8B\x44\xBE\xF8" ); }   // mov eax, [r14 + r15*4 - 8]
+static void EmitLoadTop( Jit_t* jit )   { EMIT( jit, "\x43\x8B\x44\xBE\xFC" ); }   // mov eax, [r14 + r15*4 - 4]
+static void EmitStoreTop( Jit_t* jit )  { EMIT( jit, "\x43\x89\x44\xBE\xFC" ); }   // mov [r14 + r15*4 - 4], eax
+static void EmitIncSize( Jit_t* jit )   { EMIT( jit, "\x49\xFF\xC7" ); }           // inc r15
+static void EmitDecSize( Jit_t* jit )   { EMIT( jit, "\x49\xFF\xCF" ); }           // dec r15
+
+static void EmitPopToEax( Jit_t* jit ) {
+    EmitDecSize( jit );
+    EMIT( jit, "\x43\x8B\x04\xBE" );                       // mov eax, [r14 + r15*4]
+}
+
+static void EmitPushEax( Jit_t* jit ) {
+    EMIT( jit, "\x43\x89\x04\xBE" );                       // mov [r14 + r15*4], eax
+    EmitIncSize( jit );
+}
+
+static void EmitLoadReg( Jit_t* jit, int reg ) {
+    EMIT( jit, "\x41\x8B\x84\x24" );                       // mov eax, [r12 + disp32]
+    Emit4( jit, REG_OFFSET( reg ) );
+}
+
+static void EmitStoreReg( Jit_t* jit, int reg ) {
+    EMIT( jit, "\x41\x89\x84\x24" );                       // mov [r12 + disp32], eax
+    Emit4( jit, REG_OFFSET( reg ) );
+}
+
+// Смещение в байтах помещается в disp32 только для адресов меньше 2^29 слов, дальше - через rcx
+static bool FitsDisp32( int addr ) {
+    return addr <= INT32_MAX / ( int ) sizeof( int );
+}
+
+static void EmitLoadRam( Jit_t* jit, int addr ) {
+    if ( FitsDisp32( addr ) ) {
+        EMIT( jit, "\x41\x8B\x85" );                       // mov eax, [r13 + disp32]
+        Emit4( jit, RAM_OFFSET( addr ) );
+        return;
+    }
+
+    EMIT( jit, "\xB9" );                                   // mov ecx, imm32
+    Emit4( jit, addr );
+    EMIT( jit, "\x41\x8B\x44\x8D\x00" );                   // mov eax, [r13 + rcx*4]
+}
+
+static void EmitStoreRam( Jit_t* jit, int addr ) {
+    if ( FitsDisp32( addr ) ) {
+        EMIT( jit, "\x41\x89\x85" );                       // mov [r13 + disp32], eax
+        Emit4( jit, RAM_OFFSET( addr ) );
+        return;
+    }
+
+    EMIT( jit, "\xB9" );                                   // mov ecx, imm32
+    Emit4( jit, addr );
+    EMIT( jit, "\x41\x89\x44\x8D\x00" );                   // mov [r13 + rcx*4], eax
+}
+
+static StackData_t* JitGrowStack( Processor_t* processor, size_t size ) {
+    processor->stk.size = size;
+    StackRealloc( &( processor->stk ), StackGrownCapacity( processor->stk.capacity ) );
+
+    return processor->stk.data;
+}
+
+// Перед PUSH: если стек полон, расширяем его. Портит caller-saved регистры,
+// поэтому значение загружается после проверки. Проверенной программе проверка не нужна.
+static void EmitStackCheck( Jit_t* jit ) {
+    if ( jit->fast ) return;
+
+    EMIT( jit, "\x4C\x3B\xBB" );                           // cmp r15, [rbx + capacity]
+    Emit4( jit, STK_OFFSET( capacity ) );
+    EMIT( jit, "\x72\x00" );                               // jb ok
+    size_t jump_pos = jit->size - 1;
+
+    EMIT( jit, "\x48\x89\xDF" );                           // mov rdi, rbx
+    EMIT( jit, "\x4C\x89\xFE" );                           // mov rsi, r15
+    EmitAddress( jit, "\x48\xB8", ( uintptr_t ) JitGrowStack );      // movabs rax, JitGrowStack
+    EMIT( jit, "\xFF\xD0" );                               // call rax
+    EMIT( jit, "\x49\x89\xC6" );                           // mov r14, rax
+
+    jit->bytes[ jump_pos ] = ( uint8_t ) ( jit->size - ( jump_pos + 1 ) );
+}
+
+// Вызов обработчика Proc* с синхронизацией стека; instruction_ptr указывает на следующую инструкцию
+static void EmitHandlerCall( Jit_t* jit, Instr_t* code, size_t index, ProcHandler_t handler ) {
+    EMIT( jit, "\x4C\x89\xBB" );                           // mov [rbx + size], r15
+    Emit4( jit, STK_OFFSET( size ) );
+    EMIT( jit, "\x48\xC7\x83" );                           // mov qword [rbx + instruction_ptr], index + 1
+    Emit4( jit, PROC_OFFSET( instruction_ptr ) );
+    Emit4( jit, ( int32_t ) ( index + 1 ) );
+
+    EMIT( jit, "\x48\x89\xDF" );                           // mov rdi, rbx
+    EmitAddress( jit, "\x48\xBE", ( uintptr_t ) ( code + index ) ); // movabs rsi, instr
+    EmitAddress( jit, "\x48\xB8", ( uintptr_t ) handler );           // movabs rax, handler
+    EMIT( jit, "\xFF\xD0" );                               // call rax
+
+    EMIT( jit, "\x4C\x8B\xB3" );                           // mov r14, [rbx + data]
+    Emit4( jit, STK_OFFSET( data ) );
+    EMIT( jit, "\x4C\x8B\xBB" );                           // mov r15, [rbx + size]
+    Emit4( jit, STK_OFFSET( size ) );
+}
+
+// Переход на инструкцию с номером из rax (за концом программы - выход)
+static void EmitDispatchRax( Jit_t* jit, size_t count ) {
+    EMIT( jit, "\x48\x3D" );                               // cmp rax, count
+    Emit4( jit, ( int32_t ) count );
+    EmitJcc( jit, JCC_JAE, count );
+    EmitAddress( jit, "\x48\xB9", ( uintptr_t ) jit->table );        // movabs rcx, table
+    EMIT( jit, "\xFF\x24\xC1" );                           // jmp [rcx + rax*8]
+}
+
+// Полная инструкция через обработчик Proc*: вызов, затем переход по processor->instruction_ptr
+static void EmitCallback( Jit_t* jit, Instr_t* code, size_t count, size_t index ) {
+    EmitHandlerCall( jit, code, index, code[ index ].handler );
+
+    EMIT( jit, "\x48\x8B\x83" );                           // mov rax, [rbx + instruction_ptr]
+    Emit4( jit, PROC_OFFSET( instruction_ptr ) );
+    EmitDispatchRax( jit, count );
+}
+
+static void JitIncorrectCommand( Processor_t*, const Instr_t* instr ) {
+    fprintf( stderr, COLOR_RED "Incorrect command %d \n" COLOR_RESET, instr->command );
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Трансляция инструкций
+
+static void EmitConditionalJump( Jit_t* jit, uint8_t condition, size_t target ) {
+    EmitLoadB( jit );
+    EmitLoadA( jit );
+    EMIT( jit, "\x49\x83\xEF\x02" );                       // sub r15, 2
+    EMIT( jit, "\x39\xC8" );                               // cmp eax, ecx
+    EmitJcc( jit, condition, target );
+}
+
+static void EmitConditionalJumpRegImm( Jit_t* jit, const Instr_t* instr, size_t index, uint8_t condition ) {
+    EMIT( jit, "\x41\x81\xBC\x24" );                       // cmp dword [r12 + disp32], imm32
+    Emit4( jit, REG_OFFSET( instr->reg ) );
+    Emit4( jit, instr->imm );
+    EmitJcc( jit, condition, instr->target );
+    EmitJmp( jit, index + JCC_REG_IMM_LEN );
+}
+
+// movsxd rcx, regs[ reg ]; cmp rcx, ram_size; jae slow
+static size_t EmitRamIndexCheck( Jit_t* jit, int reg ) {
+    EMIT( jit, "\x49\x63\x8C\x24" );
+    Emit4( jit, REG_OFFSET( reg ) );
+    EMIT( jit, "\x48\x81\xF9" );
+    Emit4( jit, ( int32_t ) jit->ram_size );  // Не больше RAM_MAX_SIZE
+
+    return EmitJccForward( jit, JCC_JAE );
+}
+
+static bool IsRamAddress( const Jit_t* jit, int addr ) {
+    return 0 <= addr && ( size_t ) addr < jit->ram_size;
+}
+
+static void EmitInstruction( Jit_t* jit, Instr_t* code, size_t count, size_t index ) {
+    const Instr_t* instr = code + index;
+
+    EMIT( jit, "\x48\xFF\xC5" );                           // inc rbp
+
+    switch ( instr->command ) {
+        case PUSH_CMD:
+            EmitStackCheck( jit );
+            EMIT( jit, "\x43\xC7\x04\xBE" );               // mov dword [r14 + r15*4], imm32
+            Emit4( jit, instr->imm );
+            EmitIncSize( jit );
+            break;
+
+        case POP_CMD:
+            EmitDecSize( jit );
+            break;
+
+        case ADD_CMD:
+            EmitLoadB( jit );
+            EmitDecSize( jit );
+            EMIT( jit, "\x43\x01\x4C\xBE\xFC" );           // add [r14 + r15*4 - 4], ecx
+            break;
+
+        case SUB_CMD:
+            EmitLoadB( jit );
+            EmitDecSize( jit );
+            EMIT( jit, "\x43\x29\x4C\xBE\xFC" );           // sub [r14 + r15*4 - 4], ecx
+            break;
+
+        case MUL_CMD:
+            EmitLoadB( jit );
+            EmitDecSize( jit );
+            EmitLoadTop( jit );
+            EMIT( jit, "\x0F\xAF\xC1" );                   // imul eax, ecx
+            EmitStoreTop( jit );
+            break;
+
+        case DIV_CMD: {
+            EmitLoadB( jit );
+            EMIT( jit, "\x85\xC9" );                       // test ecx, ecx
+            size_t slow_pos = EmitJccForward( jit, JCC_JE );
+
+            EmitLoadA( jit );
+            EMIT( jit, "\x99" );                           // cdq
+            EMIT( jit, "\xF7\xF9" );                       // idiv ecx
+            EmitDecSize( jit );
+            EmitStoreTop( jit );
+            EmitJmp( jit, index + 1 );
+
+            PatchHere( jit, slow_pos );                    // Деление на 0 - ошибку выдаст ProcDiv
+            EmitCallback( jit, code, count, index );
+            break;
+        }
+
+        case PUSHR_CMD:
+            EmitStackCheck( jit );
+            EmitLoadReg( jit, instr->reg );
+            EmitPushEax( jit );
+            break;
+
+        case POPR_CMD:
+            EmitPopToEax( jit );
+            EmitStoreReg( jit, instr->reg );
+            break;
+
+        case PUSHM_CMD: {
+            EmitStackCheck( jit );
+            size_t slow_pos = EmitRamIndexCheck( jit, instr->reg );
+            EMIT( jit, "\x41\x8B\x44\x8D\x00" );           // mov eax, [r13 + rcx*4]
+            EmitPushEax( jit );
+            EmitJmp( jit, index + 1 );
+
+            PatchHere( jit, slow_pos );
+            EmitCallback( jit, code, count, index );
+            break;
+        }
+
+        case POPM_CMD: {
+            size_t slow_pos = EmitRamIndexCheck( jit, instr->reg );
+            EmitPopToEax( jit );
+            EMIT( jit, "\x41\x89\x44\x8D\x00" );           // mov [r13 + rcx*4], eax
+            EmitJmp( jit, index + 1 );
+
+            PatchHere( jit, slow_pos );
+            EmitCallback( jit, code, count, index );
+            break;
+        }
+
+        case PUSHMA_CMD:
+            if ( !IsRamAddress( jit, instr->addr ) ) {
+                EmitCallback( jit, code, count, index );
+                break;
+            }
+
+            EmitStackCheck( jit );
+            EmitLoadRam( jit, instr->addr );
+            EmitPushEax( jit );
+            break;
+
+        case POPMA_CMD:
+            if ( !IsRamAddress( jit, instr->addr ) ) {
+                EmitCallback( jit, code, count, index );
+                break;
+            }
+
+            EmitPopToEax( jit );
+            EmitStoreRam( jit, instr->addr );
+            break;
+
+        case JMP_CMD: EmitJmp( jit, instr->target ); break;
+        case JB_CMD:  EmitConditionalJump( jit, JCC_JL,  instr->target ); break;
+        case JA_CMD:  EmitConditionalJump( jit, JCC_JG,  instr->target ); break;
+        case JBE_CMD: EmitConditionalJump( jit, JCC_JLE, instr->target ); break;
+        case JAE_CMD: EmitConditionalJump( jit, JCC_JGE, instr->target ); break;
+        case JE_CMD:  EmitConditionalJump( jit, JCC_JE,  instr->target ); break;
+
+        case CALL_CMD: {
+            EMIT( jit, "\x48\x8B\x83" );                   // mov rax, [rbx + refund.size]
+            Emit4( jit, REFUND_OFFSET( size ) );
+            EMIT( jit, "\x48\x3B\x83" );                   // cmp rax, [rbx + refund.capacity]
+            Emit4( jit, REFUND_OFFSET( capacity ) );
+            size_t slow_pos = EmitJccForward( jit, JCC_JAE );
+
+            EMIT( jit, "\x48\x8B\x8B" );                   // mov rcx, [rbx + refund.data]
+            Emit4( jit, REFUND_OFFSET( data ) );
+            EMIT( jit, "\xC7\x04\x81" );                   // mov dword [rcx + rax*4], index + 1
+            Emit4( jit, ( int32_t ) ( index + 1 ) );
+            EMIT( jit, "\x48\xFF\xC0" );                   // inc rax
+            EMIT( jit, "\x48\x89\x83" );                   // mov [rbx + refund.size], rax
+            Emit4( jit, REFUND_OFFSET( size ) );
+            EmitJmp( jit, instr->target );
+
+            PatchHere( jit, slow_pos );                    // Стек возврата полон - его расширит ProcCall
+            EmitCallback( jit, code, count, index );
+            break;
+        }
+
+        case RET_CMD:
+            EMIT( jit, "\x48\x8B\x83" );                   // mov rax, [rbx + refund.size]
+            Emit4( jit, REFUND_OFFSET( size ) );
+            EMIT( jit, "\x48\xFF\xC8" );                   // dec rax
+            EMIT( jit, "\x48\x89\x83" );                   // mov [rbx + refund.size], rax
+            Emit4( jit, REFUND_OFFSET( size ) );
+            EMIT( jit, "\x48\x8B\x8B" );                   // mov rcx, [rbx + refund.data]
+            Emit4( jit, REFUND_OFFSET( data ) );
+            EMIT( jit, "\x48\x63\x04\x81" );               // movsxd rax, [rcx + rax*4]
+            EmitDispatchRax( jit, count );
+            break;
+
+        case HLT_CMD:
+            EMIT( jit, "\x31\xC0" );                       // xor eax, eax
+            EmitJmp( jit, JIT_EXIT );
+            break;
+
+        case REG_ADD_IMM_CMD:
+            EMIT( jit, "\x41\x81\x84\x24" );               // add dword [r12 + disp32], imm32
+            Emit4( jit, REG_OFFSET( instr->reg ) );
+            Emit4( jit, instr->imm );
+            EmitJmp( jit, index + REG_ADD_IMM_LEN );
+            break;
+
+        case JB_REG_IMM_CMD:  EmitConditionalJumpRegImm( jit, instr, index, JCC_JL  ); break;
+        case JA_REG_IMM_CMD:  EmitConditionalJumpRegImm( jit, instr, index, JCC_JG  ); break;
+        case JBE_REG_IMM_CMD: EmitConditionalJumpRegImm( jit, instr, index, JCC_JLE ); break;
+        case JAE_REG_IMM_CMD: EmitConditionalJumpRegImm( jit, instr, index, JCC_JGE ); break;
+        case JE_REG_IMM_CMD:  EmitConditionalJumpRegImm( jit, instr, index, JCC_JE  ); break;
+
+        case LOAD_CONST_CMD:
+        case STORE_CONST_CMD:
+            EMIT( jit, "\x41\xC7\x84\x24" );               // mov dword [r12 + disp32], imm32
+            Emit4( jit, REG_OFFSET( instr->reg ) );
+            Emit4( jit, instr->addr );
+
+            if ( instr->command == LOAD_CONST_CMD ) {
+                EmitStackCheck( jit );
+                EmitLoadRam( jit, instr->addr );
+                EmitPushEax( jit );
+            } else {
+                EmitPopToEax( jit );
+                EmitStoreRam( jit, instr->addr );
+            }
+
+            EmitJmp( jit, index + CONST_RAM_LEN );
+            break;
+
+        case POW_CMD:
+        case SQRT_CMD:
+        case IN_CMD:
+        case OUT_CMD:
+        case MEMSET_CMD:  // Время уходит на ядра из memory.cpp, вызов обработчика ничего не стоит
+        case MEMCPY_CMD:
+        case MEMCMP_CMD:
+        case VADD_CMD:
+        case VMUL_CMD:
+        case VSUM_CMD:
+        case VDOT_CMD:
+            EmitCallback( jit, code, count, index );
+            break;
+
+        default:
+            if ( instr->handler ) {
+                EmitCallback( jit, code, count, index );
+                break;
+            }
+
+            EmitHandlerCall( jit, code, index, JitIncorrectCommand );
+            EMIT( jit, "\xB8\x01\x00\x00\x00" );           // mov eax, 1
+            EmitJmp( jit, JIT_EXIT );
+            break;
+    }
+}
+
+static void EmitPrologue( Jit_t* jit ) {
+    EMIT( jit, "\x53\x55\x41\x54\x41\x55\x41\x56\x41\x57" );  // push rbx, rbp, r12, r13, r14, r15
+    EMIT( jit, "\x48\x83\xEC\x08" );                       // sub rsp, 8 - выравнивание для вызовов
+    EMIT( jit, "\x48\x89\xFB" );                           // mov rbx, rdi
+
+    EMIT( jit, "\x4C\x8D\xA3" );                           // lea r12, [rbx + regs]
+    Emit4( jit, PROC_OFFSET( regs ) );
+    EMIT( jit, "\x4C\x8B\xAB" );                           // mov r13, [rbx + RAM]
+    Emit4( jit, PROC_OFFSET( RAM ) );
+    EMIT( jit, "\x4C\x8B\xB3" );                           // mov r14, [rbx + data]
+    Emit4( jit, STK_OFFSET( data ) );
+    EMIT( jit, "\x4C\x8B\xBB" );                           // mov r15, [rbx + size]
+    Emit4( jit, STK_OFFSET( size ) );
+
+    EMIT( jit, "\x31\xED" );                               // xor ebp, ebp
+    EMIT( jit, "\xFF\xE6" );                               // jmp rsi
+}
+
+static void EmitEpilogue( Jit_t* jit ) {
+    EMIT( jit, "\x4C\x89\xBB" );                           // mov [rbx + size], r15
+    Emit4( jit, STK_OFFSET( size ) );
+    EMIT( jit, "\x48\x01\xAB" );                           // add [rbx + executed_count], rbp
+    Emit4( jit, PROC_OFFSET( executed_count ) );
+
+    EMIT( jit, "\x48\x83\xC4\x08" );                       // add rsp, 8
+    EMIT( jit, "\x41\x5F\x41\x5E\x41\x5D\x41\x5C\x5D\x5B" );  // pop r15, r14, r13, r12, rbp, rbx
+    EMIT( jit, "\xC3" );                                   // ret
+}
+
+static void JitDtor( Jit_t* jit ) {
+    free( jit->bytes );
+    free( jit->offsets );
+    free( jit->fixups );
+    free( jit->table );
+
+    *jit = {};
+}
+
+// Транслирует поток в jit->bytes; коды инструкций пока без абсолютных адресов
+static bool JitTranslate( Jit_t* jit, Instr_t* code, size_t count ) {
+    if ( count >= INT32_MAX ) {
+        return false;
+    }
+
+    jit->offsets = ( size_t* ) calloc ( count + 1, sizeof( *jit->offsets ) );
+    jit->table   = ( const void** ) calloc ( count + 1, sizeof( *jit->table ) );
+    if ( !jit->offsets || !jit->table ) {
+        return false;
+    }
+
+    EmitPrologue( jit );
+
+    for ( size_t i = 0; i < count; i++ ) {
+        jit->offsets[i] = jit->size;
+        EmitInstruction( jit, code, count, i );
+    }
+
+    // Конец программы
+    jit->offsets[ count ] = jit->size;
+    EMIT( jit, "\x31\xC0" );                               // xor eax, eax
+
+    jit->exit_offset = jit->size;
+    EmitEpilogue( jit );
+
+    if ( jit->size >= INT32_MAX ) {
+        return false;
+    }
+
+    for ( size_t i = 0; i < jit->fixups_count; i++ ) {
+        const JitFixup_t* fixup = jit->fixups + i;
+        size_t target = ( fixup->target == JIT_EXIT ) ? jit->exit_offset : jit->offsets[ fixup->target ];
+
+        Patch4( jit, fixup->pos, ( int32_t ) ( ( long ) target - ( long ) ( fixup->pos + 4 ) ) );
+    }
+
+    return true;
+}
+
+// Скомпилированная программа: машинный код и таблица адресов инструкций. Processor_t код получает
+// только в rdi при входе, поэтому одну компиляцию можно исполнять для разных процессоров с тем же code
+struct JitProgram_t {
+    Jit_t  jit         = {};
+    void*  memory      = NULL;
+    size_t code_size   = 0;
+};
+
+JitProgram_t* JitCompile( Instr_t* code, size_t code_size, size_t ram_size, bool fast ) {
+    my_assert( code, ASSERT_ERR_NULL_PTR )
+
+#if defined( __x86_64__ )
+    JitProgram_t* program = ( JitProgram_t* ) calloc ( 1, sizeof( *program ) );
+    assert( program && "Memory allocation error \n" );
+    *program = {};
+
+    Jit_t* jit = &( program->jit );
+    jit->ram_size = ram_size;
+    jit->fast     = fast;
+
+    void* memory = MAP_FAILED;
+    if ( JitTranslate( jit, code, code_size ) ) {
+        memory = mmap( NULL, jit->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    }
+
+    if ( memory != MAP_FAILED ) {
+        memcpy( memory, jit->bytes, jit->size );
+
+        if ( mprotect( memory, jit->size, PROT_READ | PROT_EXEC ) != 0 ) {
+            munmap( memory, jit->size );
+            memory = MAP_FAILED;
+        }
+    }
+
+    if ( memory == MAP_FAILED ) {
+        fprintf( stderr, COLOR_YELLOW "JIT compilation failed, falling back to the interpreter \n" COLOR_RESET );
+        JitDtor( jit );
+        free( program );
+        return NULL;
+    }
+
+    const uint8_t* base = ( const uint8_t* ) memory;
+    for ( size_t i = 0; i <= code_size; i++ ) {
+        jit->table[i] = base + jit->offsets[i];
+    }
+
+    program->memory    = memory;
+    program->code_size = code_size;
+
+    PRINT( COLOR_BRIGHT_YELLOW "Compiled %lu instructions into %lu bytes \n", code_size, jit->size )
+
+    return program;
+#else
+    ( void ) code_size; ( void ) ram_size; ( void ) fast;
+    fprintf( stderr, COLOR_YELLOW "JIT is supported only on x86-64, falling back to the interpreter \n" COLOR_RESET );
+    return NULL;
+#endif
+}
+
+int JitExecute( const JitProgram_t* program, Processor_t* processor ) {
+    my_assert( program,   ASSERT_ERR_NULL_PTR )
+    my_assert( processor, ASSERT_ERR_NULL_PTR )
+
+    JitEntry_t entry = NULL;
+    memcpy( &entry, &( program->memory ), sizeof( entry ) );
+
+    size_t start = ( processor->instruction_ptr < program->code_size ) ? processor->instruction_ptr
+                                                                       : program->code_size;
+
+    return entry( processor, program->jit.table[ start ] );
+}
+
+void JitRelease( JitProgram_t* program ) {
+    if ( program == NULL ) return;
+
+    munmap( program->memory, program->jit.size );
+    JitDtor( &( program->jit ) );
+    free( program );
+}
+
+int ByteCodeProcessingJit( Processor_t* processor ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR )
+
+    PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ );
+
+    JitProgram_t* program = JitCompile( processor->code, processor->code_size, processor->ram_size, processor->fast );
+    if ( program == NULL ) {
+        return ByteCodeProcessing( processor );
+    }
+
+    int result = JitExecute( program, processor );
+    JitRelease( program );
+
+    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
+
+    return result;
+}
@@ -1,17 +1,162 @@
+#include <time.h>
+
 #include "processor.h"      // TODO: massive of struct for Processor command
 
+static double SecondsNow() {
+    timespec now = {};
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( double ) now.tv_sec + ( double ) now.tv_nsec * 1e-9;
+}
+
+static const char* EngineName( Engine_t engine ) {
+    switch ( engine ) {
+        case ENGINE_SWITCH:   return "switch";
+        case ENGINE_THREADED: return "threaded";
+        case ENGINE_TOS:      return "tos";
+        case ENGINE_JIT:      return "jit";
+        default:              return "unknown";
+    }
+}
+
+static const char* RamImageModeName( RamImageMode_t mode ) {
+    switch ( mode ) {
+        case RAM_IMAGE_PRIVATE: return "private";
+        case RAM_IMAGE_SHARED:  return "shared";
+        case RAM_IMAGE_SYNC:    return "sync";
+        default:                return "unknown";
+    }
+}
+
+static void PrintVerifierStats( const Processor_t* processor ) {
+    if ( processor->verified ) {
+        fprintf( stderr, "Stats: verifier = verified; max stack depth = %lu; stack checks = %s \n",
+                 processor->max_stack_depth, ( processor->fast ) ? "off" : "on" );
+    }
+    else {
+        fprintf( stderr, "Stats: verifier = not verified ( stack depth differs between paths at address %lu ); stack checks = on \n",
+                 processor->unverified_word );
+    }
+}
+
+static void PrintStackStats( const char* name, const Stack_t* stk ) {
+    fprintf( stderr, "Stats: %s capacity = %lu (initial %lu); reallocs = %lu; poisoned cells = %lu \n",
+             name, stk->capacity, stk->min_capacity, stk->realloc_count, stk->poison_count );
+}
+
+static ProcEngine_t EngineFunction( Engine_t engine ) {
+    switch ( engine ) {
+        case ENGINE_THREADED: return ByteCodeProcessingThreaded;
+        case ENGINE_TOS:      return ByteCodeProcessingTos;
+        case ENGINE_JIT:      return ByteCodeProcessingJit;
+        case ENGINE_SWITCH:
+        default:              return ByteCodeProcessing;
+    }
+}
+
 int main( int argc, char** argv ) {
-    FileStat exe_file = {};
-    ArgvProcessing( argc, argv, &exe_file );
+    FileStat  exe_file = {};
+    Options_t options  = {};
+    ArgvProcessing( argc, argv, &exe_file, &options );
+    SelectVectorKernels( options.simd );
 
     Processor_t processor = {};
-    ProcCtor( &processor, 8, 5 );
+    ProcCtor( &processor, options.stack_size, options.refund_stack_size, options.ram_size );
+    processor.stk.never_shrink        = options.never_shrink;
+    processor.refund_stk.never_shrink = options.never_shrink;
+    processor.sscanf_loader           = options.sscanf_loader;
+
+    double load_start = SecondsNow();
+
+    if ( ExeFileToByteCode( &processor, &exe_file ) != SUCCESS ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Incorrect byte code in \"%s\" \n" COLOR_RESET, exe_file.address );
+        ProcDtor( &processor );
+        free( exe_file.address );
+        free( options.batch_manifest );
+        free( options.ram_image );
+        return EXIT_FAILURE;
+    }
 
-    ExeFileToByteCode( &processor, &exe_file );
+    if ( options.ram_image ) {
+        // Запуски пакета идут параллельно, и общая RAM сделала бы их зависимыми
+        if ( options.batch_manifest && options.ram_image_mode != RAM_IMAGE_PRIVATE ) {
+            fprintf( stderr, "Warning: RAM image is mapped privately in batch mode \n" );
+            options.ram_image_mode = RAM_IMAGE_PRIVATE;
+        }
 
-    int result = ByteCodeProcessing( &processor );
+        if ( OpenRamImage( &processor, options.ram_image, options.ram_image_mode ) != SUCCESS ) {
+            ProcDtor( &processor );
+            free( exe_file.address );
+            free( options.batch_manifest );
+            free( options.ram_image );
+            return EXIT_FAILURE;
+        }
+    }
+
+    double load_time = SecondsNow() - load_start;
+
+    // Проверенной программе стек не нужно расширять: он сразу получает наибольшую глубину
+    processor.fast = options.fast && processor.verified;
+    if ( processor.fast ) {
+        ReserveVerifiedStack( &processor );
+    }
+
+    if ( options.fuse ) {
+        FuseInstructions( &processor );
+    }
+
+    if ( options.batch_manifest ) {
+        int batch_result = ByteCodeProcessingBatch( &processor, &options, EngineFunction( options.engine ) );
+
+        if ( options.stats ) {
+            fprintf( stderr, "Stats: engine = %s; fused = %lu; load = %.6f s; words = %lu; file = %ld bytes \n",
+                     EngineName( options.engine ), processor.fused_count,
+                     load_time, processor.instruction_count, exe_file.size );
+            PrintVerifierStats( &processor );
+        }
+
+        ProcDtor( &processor );
+        free( exe_file.address );
+        free( options.batch_manifest );
+        free( options.ram_image );
+
+        return ( batch_result == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    double start_time = SecondsNow();
+
+    int result = EngineFunction( options.engine )( &processor );
+
+    double run_time = SecondsNow() - start_time;
+
+    // После HLT результаты в образе RAM должны быть на диске, иначе запуск не удался
+    if ( result != 1 && !FlushRamImage( &processor ) ) {
+        fprintf( stderr, COLOR_BRIGHT_RED "Can not flush RAM image \"%s\" \n" COLOR_RESET, options.ram_image );
+        result = 1;
+    }
+
+    if ( options.stats ) {
+        fprintf( stderr, "Stats: engine = %s; fused = %lu; executed = %lu instructions; time = %.6f s; speed = %.0f instr/s \n",
+                 EngineName( options.engine ), processor.fused_count,
+                 processor.executed_count, run_time,
+                 ( run_time > 0 ) ? ( double ) processor.executed_count / run_time : 0.0 );
+        fprintf( stderr, "Stats: load = %.6f s; words = %lu; file = %ld bytes \n",
+                 load_time, processor.instruction_count, exe_file.size );
+        fprintf( stderr, "Stats: RAM = %lu words; touched = %lu KB; vector kernels = %s \n",
+                 processor.ram_size, RamResidentBytes( &processor ) / 1024, VectorKernelsName() );
+        if ( options.ram_image ) {
+            fprintf( stderr, "Stats: RAM image = %lu words ( %s ) \n", processor.ram_image_size,
+                     RamImageModeName( processor.ram_image_mode ) );
+        }
+        PrintVerifierStats( &processor );
+        PrintStackStats( "stack",        &( processor.stk        ) );
+        PrintStackStats( "refund stack", &( processor.refund_stk ) );
+    }
 
     ProcDtor( &processor );
+    free( exe_file.address );
+    free( options.batch_manifest );
+    free( options.ram_image );
 
     if ( result == 1 ) {
         fprintf( stderr, COLOR_BRIGHT_RED "Incorrect processor operation \n" );
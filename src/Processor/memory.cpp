@@ -0,0 +1,227 @@
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+#include "processor.h"
+
+// Операции над диапазонами RAM ( MEMSET, MEMCPY, MEMCMP ). Границы проверяет CheckRamRange один раз
+// на весь диапазон, дальше работают ядра без проверок: заполнение и сравнение - по 4 слова
+// в регистре SSE2, копирование - memmove библиотеки C, которая сама выбирает векторный вариант.
+
+void CheckRamRange( size_t ram_size, int address, int count ) {
+    if ( address < 0 || count < 0 || ( size_t ) address + ( size_t ) count > ram_size ) {
+        fprintf( stderr, COLOR_RED "RAM range out of bounds: %d words from %d" COLOR_RESET "\n", count, address );
+        assert( 0 && "RAM access violation" );
+    }
+}
+
+void RamFill( int* dst, int value, size_t count ) {
+    // Нули заполняет memset: он быстрее всего и для байтов, и для слов
+    if ( value == 0 ) {
+        memset( dst, 0, count * sizeof( *dst ) );
+        return;
+    }
+
+    size_t i = 0;
+
+#ifdef __SSE2__
+    __m128i vector = _mm_set1_epi32( value );
+
+    for ( ; i + 16 <= count; i += 16 ) {
+        _mm_storeu_si128( ( __m128i* ) ( dst + i      ), vector );
+        _mm_storeu_si128( ( __m128i* ) ( dst + i + 4  ), vector );
+        _mm_storeu_si128( ( __m128i* ) ( dst + i + 8  ), vector );
+        _mm_storeu_si128( ( __m128i* ) ( dst + i + 12 ), vector );
+    }
+    for ( ; i + 4 <= count; i += 4 ) {
+        _mm_storeu_si128( ( __m128i* ) ( dst + i ), vector );
+    }
+#endif
+
+    for ( ; i < count; i++ ) {
+        dst[i] = value;
+    }
+}
+
+// Диапазоны могут перекрываться: результат как при копировании через промежуточный буфер
+void RamCopy( int* dst, const int* src, size_t count ) {
+    if ( dst != src ) memmove( dst, src, count * sizeof( *dst ) );
+}
+
+// -1, 0 или 1 по первому различающемуся слову ( сравнение со знаком )
+int RamCompare( const int* first, const int* second, size_t count ) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for ( ; i + 4 <= count; i += 4 ) {
+        __m128i a = _mm_loadu_si128( ( const __m128i* ) ( first  + i ) );
+        __m128i b = _mm_loadu_si128( ( const __m128i* ) ( second + i ) );
+
+        if ( _mm_movemask_epi8( _mm_cmpeq_epi32( a, b ) ) != 0xFFFF ) break;
+    }
+#endif
+
+    for ( ; i < count; i++ ) {
+        if ( first[i] != second[i] ) return ( first[i] < second[i] ) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Векторные команды ( VADD, VMUL, VSUM, VDOT ). Арифметика по модулю 2^32, как у ADD и MUL.
+// Ядра выбираются при запуске: AVX2 ( 8 слов за инструкцию ), если процессор его поддерживает ( CPUID ),
+// иначе скалярные. Сумма по модулю 2^32 не зависит от порядка сложения, поэтому результаты совпадают.
+
+typedef void ( *VectorBinary_t )( int* dst, const int* a, const int* b, size_t count );
+typedef int  ( *VectorSum_t    )( const int* a, size_t count );
+typedef int  ( *VectorDot_t    )( const int* a, const int* b, size_t count );
+
+struct VectorKernels_t {
+    const char*    name = NULL;
+    VectorBinary_t add  = NULL;
+    VectorBinary_t mul  = NULL;
+    VectorSum_t    sum  = NULL;
+    VectorDot_t    dot  = NULL;
+};
+
+static void ScalarAdd( int* dst, const int* a, const int* b, size_t count ) {
+    for ( size_t i = 0; i < count; i++ ) dst[i] = ( int ) ( ( unsigned ) a[i] + ( unsigned ) b[i] );
+}
+
+static void ScalarMul( int* dst, const int* a, const int* b, size_t count ) {
+    for ( size_t i = 0; i < count; i++ ) dst[i] = ( int ) ( ( unsigned ) a[i] * ( unsigned ) b[i] );
+}
+
+static int ScalarSum( const int* a, size_t count ) {
+    unsigned sum = 0;
+    for ( size_t i = 0; i < count; i++ ) sum += ( unsigned ) a[i];
+
+    return ( int ) sum;
+}
+
+static int ScalarDot( const int* a, const int* b, size_t count ) {
+    unsigned sum = 0;
+    for ( size_t i = 0; i < count; i++ ) sum += ( unsigned ) a[i] * ( unsigned ) b[i];
+
+    return ( int ) sum;
+}
+
+static const VectorKernels_t SCALAR_KERNELS = { "scalar", ScalarAdd, ScalarMul, ScalarSum, ScalarDot };
+
+#ifdef __x86_64__
+// Файл собирается без -mavx2: AVX2 включен только в этих функциях, вызываются они после проверки CPUID
+#define AVX2_KERNEL __attribute__(( target( "avx2" ) ))
+
+AVX2_KERNEL static void Avx2Add( int* dst, const int* a, const int* b, size_t count ) {
+    size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 ) {
+        __m256i x = _mm256_loadu_si256( ( const __m256i* ) ( a + i ) );
+        __m256i y = _mm256_loadu_si256( ( const __m256i* ) ( b + i ) );
+        _mm256_storeu_si256( ( __m256i* ) ( dst + i ), _mm256_add_epi32( x, y ) );
+    }
+
+    ScalarAdd( dst + i, a + i, b + i, count - i );
+}
+
+AVX2_KERNEL static void Avx2Mul( int* dst, const int* a, const int* b, size_t count ) {
+    size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 ) {
+        __m256i x = _mm256_loadu_si256( ( const __m256i* ) ( a + i ) );
+        __m256i y = _mm256_loadu_si256( ( const __m256i* ) ( b + i ) );
+        _mm256_storeu_si256( ( __m256i* ) ( dst + i ), _mm256_mullo_epi32( x, y ) );
+    }
+
+    ScalarMul( dst + i, a + i, b + i, count - i );
+}
+
+AVX2_KERNEL static int Avx2Horizontal( __m256i vector ) {
+    __m128i sum = _mm_add_epi32( _mm256_castsi256_si128( vector ), _mm256_extracti128_si256( vector, 1 ) );
+    sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, 0x4E ) );
+    sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, 0xB1 ) );
+
+    return _mm_cvtsi128_si32( sum );
+}
+
+// Два независимых аккумулятора: сложения соседних итераций не ждут друг друга
+AVX2_KERNEL static int Avx2Sum( const int* a, size_t count ) {
+    __m256i first  = _mm256_setzero_si256();
+    __m256i second = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for ( ; i + 16 <= count; i += 16 ) {
+        first  = _mm256_add_epi32( first,  _mm256_loadu_si256( ( const __m256i* ) ( a + i     ) ) );
+        second = _mm256_add_epi32( second, _mm256_loadu_si256( ( const __m256i* ) ( a + i + 8 ) ) );
+    }
+
+    unsigned sum = ( unsigned ) Avx2Horizontal( _mm256_add_epi32( first, second ) );
+
+    return ( int ) ( sum + ( unsigned ) ScalarSum( a + i, count - i ) );
+}
+
+AVX2_KERNEL static int Avx2Dot( const int* a, const int* b, size_t count ) {
+    __m256i first  = _mm256_setzero_si256();
+    __m256i second = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for ( ; i + 16 <= count; i += 16 ) {
+        __m256i x0 = _mm256_loadu_si256( ( const __m256i* ) ( a + i     ) );
+        __m256i y0 = _mm256_loadu_si256( ( const __m256i* ) ( b + i     ) );
+        __m256i x1 = _mm256_loadu_si256( ( const __m256i* ) ( a + i + 8 ) );
+        __m256i y1 = _mm256_loadu_si256( ( const __m256i* ) ( b + i + 8 ) );
+        first  = _mm256_add_epi32( first,  _mm256_mullo_epi32( x0, y0 ) );
+        second = _mm256_add_epi32( second, _mm256_mullo_epi32( x1, y1 ) );
+    }
+
+    unsigned sum = ( unsigned ) Avx2Horizontal( _mm256_add_epi32( first, second ) );
+
+    return ( int ) ( sum + ( unsigned ) ScalarDot( a + i, b + i, count - i ) );
+}
+
+#undef AVX2_KERNEL
+
+static const VectorKernels_t AVX2_KERNELS = { "avx2", Avx2Add, Avx2Mul, Avx2Sum, Avx2Dot };
+#endif
+
+static VectorKernels_t DetectVectorKernels() {
+#ifdef __x86_64__
+    __builtin_cpu_init();  // Выбор идет из статического инициализатора, до main
+    if ( __builtin_cpu_supports( "avx2" ) ) return AVX2_KERNELS;
+#endif
+
+    return SCALAR_KERNELS;
+}
+
+static VectorKernels_t vector_kernels = DetectVectorKernels();
+
+void SelectVectorKernels( bool simd ) {
+    vector_kernels = ( simd ) ? DetectVectorKernels() : SCALAR_KERNELS;
+}
+
+const char* VectorKernelsName() {
+    return vector_kernels.name;
+}
+
+// Частичное перекрытие dst с источником: векторное ядро прочитало бы слова до их записи,
+// поэтому такой случай идет скалярным циклом по возрастанию адресов, как в C-бэкенде
+static bool PartialOverlap( const int* dst, const int* src, size_t count ) {
+    return dst != src && dst < src + count && src < dst + count;
+}
+
+void RamVectorAdd( int* dst, const int* a, const int* b, size_t count ) {
+    if ( PartialOverlap( dst, a, count ) || PartialOverlap( dst, b, count ) ) ScalarAdd( dst, a, b, count );
+    else                                                                     vector_kernels.add( dst, a, b, count );
+}
+
+void RamVectorMul( int* dst, const int* a, const int* b, size_t count ) {
+    if ( PartialOverlap( dst, a, count ) || PartialOverlap( dst, b, count ) ) ScalarMul( dst, a, b, count );
+    else                                                                     vector_kernels.mul( dst, a, b, count );
+}
+
+int RamVectorSum( const int* a, size_t count ) {
+    return vector_kernels.sum( a, count );
+}
+
+int RamVectorDot( const int* a, const int* b, size_t count ) {
+    return vector_kernels.dot( a, b, count );
+}
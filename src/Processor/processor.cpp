@@ -1,20 +1,22 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
 #include "processor.h"
 
 
-void ProcCtor( Processor_t* processor, size_t stack_size, size_t refund_stack_size ) {
+void ProcCtor( Processor_t* processor, size_t stack_size, size_t refund_stack_size, size_t ram_size ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR )
 
     StackCtor( &( processor->stk ), stack_size );
     StackCtor( &( processor->refund_stk ), refund_stack_size );
-    
-    // Инициализируем оперативную память (RAM)
-    processor->RAM = (int*) calloc( RAM_SIZE, sizeof(int) );
-    assert( processor->RAM && "RAM memory allocation error" );
-    
-    // Инициализируем RAM нулями (calloc уже делает это, но для явности)
-    for ( int i = 0; i < RAM_SIZE; i++ ) {
-        processor->RAM[i] = 0;
-    }
+
+    // Анонимное отображение уже заполнено нулями, а страницы занимаются только при первом обращении,
+    // так что большая RAM ничего не стоит программе, которая ее не использует
+    processor->ram_size = ram_size;
+    processor->RAM = ( int* ) mmap( NULL, ram_size * sizeof( int ), PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+    assert( processor->RAM != MAP_FAILED && "RAM memory allocation error" );
 }
 
 void ProcDtor( Processor_t* processor ) {
@@ -22,12 +24,120 @@ void ProcDtor( Processor_t* processor ) {
 
     StackDtor( &( processor->stk        ) );
     StackDtor( &( processor->refund_stk ) );
-    free( processor->byte_code );
+    free( processor->text_code );
+    processor->text_code = NULL;
+    if ( processor->exe_map ) {
+        munmap( processor->exe_map, processor->exe_map_size );
+        processor->exe_map = NULL;
+    }
     processor->byte_code = NULL;
+    free( processor->code );
+    processor->code = NULL;
     
     // Освобождаем оперативную память
-    free( processor->RAM );
-    processor->RAM = NULL;
+    if ( processor->RAM ) {
+        munmap( processor->RAM, processor->ram_size * sizeof( int ) );
+        processor->RAM = NULL;
+    }
+    if ( processor->ram_image_fd >= 0 ) {
+        close( processor->ram_image_fd );
+        processor->ram_image_fd = -1;
+    }
+}
+
+size_t RamResidentBytes( const Processor_t* processor ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    size_t page_size = ( size_t ) sysconf( _SC_PAGESIZE );
+    size_t pages     = ( processor->ram_size * sizeof( int ) + page_size - 1 ) / page_size;
+
+    unsigned char* resident = ( unsigned char* ) calloc ( pages + 1, sizeof( *resident ) );
+    assert( resident && "Memory allocation error \n" );
+
+    size_t bytes = 0;
+    if ( mincore( processor->RAM, processor->ram_size * sizeof( int ), resident ) == 0 ) {
+        for ( size_t i = 0; i < pages; i++ ) bytes += ( resident[i] & 1 ) ? page_size : 0;
+    }
+
+    free( resident );
+
+    return bytes;
+}
+
+ProcessorStatus_t OpenRamImage( Processor_t* processor, const char* address, RamImageMode_t mode ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+    my_assert( address,   ASSERT_ERR_NULL_PTR );
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    fprintf( stderr, COLOR_RED "RAM image \"%s\" is not supported on big-endian hosts \n" COLOR_RESET, address );
+    return INVALID_EXE_CODE;
+#endif
+
+    int fd = open( address, ( mode == RAM_IMAGE_PRIVATE ) ? O_RDONLY : O_RDWR | O_CREAT, 0666 );
+    if ( fd < 0 ) {
+        fprintf( stderr, COLOR_RED "Can not open RAM image \"%s\": %s \n" COLOR_RESET, address, strerror( errno ) );
+        return FILE_NOT_FOUND;
+    }
+
+    processor->ram_image_fd = fd;
+
+    struct stat file_stat = {};
+    if ( fstat( fd, &file_stat ) != 0 ) {
+        return FILE_NOT_FOUND;
+    }
+
+    size_t bytes = ( size_t ) file_stat.st_size;
+
+    // Новый образ для записи результатов занимает всю RAM, файл разреженный: место на диске - только под записанные страницы
+    if ( bytes == 0 && mode != RAM_IMAGE_PRIVATE ) {
+        bytes = processor->ram_size * sizeof( int );
+        if ( ftruncate( fd, ( off_t ) bytes ) != 0 ) {
+            fprintf( stderr, COLOR_RED "Can not create RAM image \"%s\": %s \n" COLOR_RESET, address, strerror( errno ) );
+            return FILE_NOT_FOUND;
+        }
+    }
+
+    if ( bytes % sizeof( int ) != 0 ) {
+        fprintf( stderr, COLOR_RED "RAM image \"%s\" of %lu bytes is not a whole number of words \n" COLOR_RESET, address, bytes );
+        return INVALID_EXE_CODE;
+    }
+
+    return MapRamImage( processor, fd, bytes / sizeof( int ), mode );
+}
+
+ProcessorStatus_t MapRamImage( Processor_t* processor, int fd, size_t words, RamImageMode_t mode ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    if ( words > processor->ram_size ) {
+        fprintf( stderr, COLOR_RED "RAM image of %lu words does not fit into RAM of %lu words ( see -M ) \n" COLOR_RESET,
+                 words, processor->ram_size );
+        return INVALID_EXE_CODE;
+    }
+
+    processor->ram_image_size = words;
+    processor->ram_image_mode = mode;
+
+    if ( words == 0 ) return SUCCESS;
+
+    // Отображение файла поверх начала анонимной RAM ( MAP_FIXED ): дальше RAM остается анонимной,
+    // и munmap в ProcDtor снимает обе части. Страницы файла читаются только при обращении
+    int flags = MAP_FIXED | ( ( mode == RAM_IMAGE_PRIVATE ) ? MAP_PRIVATE : MAP_SHARED );
+
+    void* map = mmap( processor->RAM, words * sizeof( int ), PROT_READ | PROT_WRITE, flags, fd, 0 );
+    if ( map == MAP_FAILED ) {
+        fprintf( stderr, COLOR_RED "Can not map RAM image: %s \n" COLOR_RESET, strerror( errno ) );
+        return FILE_NOT_FOUND;
+    }
+
+    return SUCCESS;
+}
+
+bool FlushRamImage( const Processor_t* processor ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    if ( processor->ram_image_mode != RAM_IMAGE_SYNC || processor->ram_image_size == 0 ) return true;
+
+    return msync( processor->RAM, processor->ram_image_size * sizeof( int ), MS_SYNC ) == 0;
 }
 
 // ProcessorStatus_t ProcVerify( Processor_t* processor ) {                // TODO: add Verify!!!
@@ -40,7 +150,7 @@ ProcessorStatus_t ProcDump( const Processor_t* processor, const int error ) {
 
     printf( COLOR_BRIGHT_YELLOW "+=+=+=+=+=+=+=+=+=+ PROCESSOR +=+=+=+=+=+=+=+=+=+ \n" );
     printf( COLOR_CYAN          "Processor address: " COLOR_RESET "%p \n", processor );
-    printf( COLOR_CYAN          "Byte code pointer: " COLOR_RESET "%p \n", (void*)processor->byte_code );
+    printf( COLOR_CYAN          "Byte code pointer: " COLOR_RESET "%p \n", ( const void* ) processor->byte_code );
 
     PrintByteCodeInline( processor );
     PrintRegisters( processor );
@@ -60,19 +170,19 @@ ProcessorStatus_t ProcDump( const Processor_t* processor, const int error ) {
 void PrintByteCodeInline(const Processor_t* processor) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
-    PRINT( COLOR_BRIGHT_YELLOW "\nBytecode:\n" );
+    PRINT( COLOR_BRIGHT_YELLOW "\nDecoded code:\n" );
 
-    for ( size_t i = 0; i < processor->instruction_count; i++ ) {
+    for ( size_t i = 0; i < processor->code_size; i++ ) {
         if ( i == processor->instruction_ptr ) {
-            PRINT( COLOR_BRIGHT_RED ">%d< ", processor->byte_code[i] );
+            PRINT( COLOR_BRIGHT_RED ">%d< ", processor->code[i].command );
         } else {
-            PRINT( " %d  ", processor->byte_code[i] );
+            PRINT( " %d  ", processor->code[i].command );
         }
     }
     PRINT( "\n" );
 
-    PRINT( COLOR_BRIGHT_CYAN "instruction_ptr = %lu; instruction_count = %lu\n",
-           processor->instruction_ptr, processor->instruction_count );
+    PRINT( COLOR_BRIGHT_CYAN "instruction_ptr = %lu; code_size = %lu\n",
+           processor->instruction_ptr, processor->code_size );
 }
 
 void PrintRegisters( const Processor_t* processor ) {
@@ -94,8 +204,8 @@ void PrintRAM( const Processor_t* processor ) {
 
     PRINT( COLOR_BRIGHT_GREEN "\nRAM (first 20 elements):\n" );
 
-    for ( int i = 0; i < 20 && i < RAM_SIZE; i++ ) {
-        PRINT( " RAM[%2d] = %5d  ", i, processor->RAM[i] );
+    for ( size_t i = 0; i < 20 && i < processor->ram_size; i++ ) {
+        PRINT( " RAM[%2lu] = %5d  ", i, processor->RAM[i] );
 
         if ( ( i + 1 ) % 5 == 0 ) PRINT( "\n" );
     }
@@ -104,35 +214,384 @@ void PrintRAM( const Processor_t* processor ) {
 }
 #endif
 
-void ExeFileToByteCode( Processor_t* processor, FileStat* file ) {
+static bool IsSpace( char c ) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static const char* SkipSpaces( const char* ptr ) {
+    while ( IsSpace( *ptr ) ) ptr++;
+
+    return ptr;
+}
+
+// Целое со знаком, занимающее весь токен до пробела или конца буфера.
+// При успехе сдвигает *ptr за токен; false - токен не число или не помещается в [ min, max ].
+static bool ScanNumber( const char** ptr, long long min, long long max, long long* value ) {
+    const char* p = *ptr;
+
+    bool negative = ( *p == '-' );
+    if ( *p == '-' || *p == '+' ) p++;
+
+    if ( ( unsigned ) ( *p - '0' ) >= 10 ) return false;
+
+    long long number = 0;
+    for ( ; ( unsigned ) ( *p - '0' ) < 10; p++ ) {
+        number = number * 10 + ( *p - '0' );
+        if ( number > max + 1 && number > -min ) return false;  // Дальше только переполнение
+    }
+
+    if ( *p != '\0' && !IsSpace( *p ) ) return false;
+
+    number = negative ? -number : number;
+    if ( number < min || number > max ) return false;
+
+    *value = number;
+    *ptr   = p;
+
+    return true;
+}
+
+static void PrintMalformedToken( const char* buffer, const char* token ) {
+    int length = 0;
+    while ( token[ length ] != '\0' && !IsSpace( token[ length ] ) && length < 32 ) length++;
+
+    fprintf( stderr, COLOR_RED "Malformed token \"%.*s\" at byte offset %lu \n" COLOR_RESET,
+             length, token, ( size_t ) ( token - buffer ) );
+}
+
+// Однопроходный разбор "count v v v ...": число значений должно совпадать с count
+static ProcessorStatus_t ParseTextByteCode( Processor_t* processor, const char* buffer, size_t size ) {
+    const char* ptr = SkipSpaces( buffer );
+
+    long long count = 0;
+    if ( !ScanNumber( &ptr, 0, INT32_MAX, &count ) ) {
+        PrintMalformedToken( buffer, ptr );
+        return INVALID_EXE_CODE;
+    }
+
+    // Каждое значение занимает хотя бы цифру и разделитель - больший count заведомо неверен
+    if ( ( size_t ) count > size / 2 + 1 ) {
+        fprintf( stderr, COLOR_RED "Header count %lld does not fit into a file of %lu bytes \n" COLOR_RESET, count, size );
+        return INVALID_EXE_CODE;
+    }
+
+    processor->instruction_count = ( size_t ) count;
+    processor->text_code = ( int* ) calloc ( processor->instruction_count, sizeof( *processor->text_code ) );
+    assert( processor->text_code && "Memory allocation error \n" );
+    processor->byte_code = processor->text_code;
+
+    for ( size_t i = 0; i < processor->instruction_count; i++ ) {
+        ptr = SkipSpaces( ptr );
+
+        if ( *ptr == '\0' ) {
+            fprintf( stderr, COLOR_RED "Expected %lu values, found %lu \n" COLOR_RESET, processor->instruction_count, i );
+            return INVALID_EXE_CODE;
+        }
+
+        long long value = 0;
+        if ( !ScanNumber( &ptr, INT32_MIN, INT32_MAX, &value ) ) {
+            PrintMalformedToken( buffer, ptr );
+            return INVALID_EXE_CODE;
+        }
+
+        processor->text_code[i] = ( int ) value;
+    }
+
+    ptr = SkipSpaces( ptr );
+    if ( *ptr != '\0' ) {
+        fprintf( stderr, COLOR_RED "Extra data after %lu values at byte offset %lu \n" COLOR_RESET,
+                 processor->instruction_count, ( size_t ) ( ptr - buffer ) );
+        return INVALID_EXE_CODE;
+    }
+
+    return SUCCESS;
+}
+
+static ProcessorStatus_t ReadTextExe( Processor_t* processor, FileStat* file ) {
+    TextFile_t text = {};
+    if ( !MapTextFile( file, &text ) ) {
+        return FILE_NOT_FOUND;
+    }
+
+    ProcessorStatus_t status = SUCCESS;
+
+    if ( processor->sscanf_loader ) {
+        int    number_of_characters_read = 0;
+        sscanf( text.text, "%lu%n", &( processor->instruction_count ), &number_of_characters_read );
+
+        processor->text_code = ( int* ) calloc ( processor->instruction_count, sizeof( *processor->text_code ) );
+        assert( processor->text_code && "Memory allocation error \n" );
+        processor->byte_code = processor->text_code;
+
+        FillInByteCode( processor, text.text + number_of_characters_read );
+    } else {
+        status = ParseTextByteCode( processor, text.text, text.size );
+    }
+
+    fprintf( stderr, "\n" );
+
+    UnmapTextFile( &text );
+
+    return status;
+}
+
+static bool SectionFits( uint32_t offset, uint32_t words, size_t file_size ) {
+    return offset % sizeof( int ) == 0
+        && ( uint64_t ) offset + ( uint64_t ) words * sizeof( int ) <= file_size;
+}
+
+static uint32_t LittleEndian( uint32_t word ) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return word;
+#else
+    return __builtin_bswap32( word );
+#endif
+}
+
+// Двоичный формат отображается в память только для чтения: слова кода не копируются в буфер,
+// DecodeByteCode читает их прямо из отображения. Исполняется, как и у текстового формата,
+// декодированный поток Instr_t - его строит загрузка в любом случае.
+// Если файл не начинается с EXE_MAGIC, *is_binary = false и ничего не меняется.
+static ProcessorStatus_t MapBinaryExe( Processor_t* processor, FileStat* file, bool* is_binary ) {
+    *is_binary = false;
+
+    int fd = open( file->address, O_RDONLY );
+    if ( fd < 0 ) {
+        return FILE_NOT_FOUND;
+    }
+
+    struct stat file_stat = {};
+    if ( fstat( fd, &file_stat ) != 0 || ( size_t ) file_stat.st_size < sizeof( ExeHeader_t ) ) {
+        close( fd );
+        return SUCCESS;
+    }
+
+    size_t map_size = ( size_t ) file_stat.st_size;
+    void*  map      = mmap( NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if ( map == MAP_FAILED ) {
+        return FILE_NOT_FOUND;
+    }
+
+    ExeHeader_t header = {};
+    memcpy( &header, map, sizeof( header ) );
+
+    if ( LittleEndian( header.magic ) != EXE_MAGIC ) {
+        munmap( map, map_size );
+        return SUCCESS;
+    }
+
+    *is_binary = true;
+    processor->exe_map      = map;
+    processor->exe_map_size = map_size;
+    file->size              = ( off_t ) map_size;
+
+    uint32_t version     = LittleEndian( header.version     );
+    uint32_t flags       = LittleEndian( header.flags       );
+    uint32_t code_offset = LittleEndian( header.code_offset );
+    uint32_t code_size   = LittleEndian( header.code_size   );
+    uint32_t ram_offset  = LittleEndian( header.ram_offset  );
+    uint32_t ram_size    = LittleEndian( header.ram_size    );
+    uint32_t entry       = LittleEndian( header.entry       );
+
+    if ( version != EXE_VERSION ) {
+        fprintf( stderr, COLOR_RED "Unsupported executable version %u (expected %u) \n" COLOR_RESET, version, EXE_VERSION );
+        return INVALID_EXE_CODE;
+    }
+
+    if ( !SectionFits( code_offset, code_size, map_size ) ||
+         ( ram_size > 0 && !SectionFits( ram_offset, ram_size, map_size ) ) ) {
+        fprintf( stderr, COLOR_RED "Executable sections are out of the file \n" COLOR_RESET );
+        return INVALID_EXE_CODE;
+    }
+
+    if ( ram_size > processor->ram_size ) {
+        fprintf( stderr, COLOR_RED "Initial RAM of %u words does not fit into RAM of %lu words ( see -M ) \n" COLOR_RESET,
+                 ram_size, processor->ram_size );
+        return INVALID_EXE_CODE;
+    }
+
+    const uint8_t* base = ( const uint8_t* ) map;
+
+    processor->instruction_count = code_size;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    processor->byte_code = ( const int* ) ( const void* ) ( base + code_offset );
+#else
+    processor->text_code = ( int* ) calloc ( code_size, sizeof( *processor->text_code ) );
+    assert( processor->text_code && "Memory allocation error \n" );
+    for ( uint32_t i = 0; i < code_size; i++ ) {
+        uint32_t word = 0;
+        memcpy( &word, base + code_offset + i * sizeof( word ), sizeof( word ) );
+        processor->text_code[i] = ( int ) LittleEndian( word );
+    }
+    processor->byte_code = processor->text_code;
+#endif
+
+    for ( uint32_t i = 0; i < ram_size; i++ ) {
+        uint32_t word = 0;
+        memcpy( &word, base + ram_offset + i * sizeof( word ), sizeof( word ) );
+        processor->RAM[i] = ( int ) LittleEndian( word );
+    }
+    processor->ram_loaded = ram_size;
+
+    if ( flags & EXE_FLAG_ENTRY ) {
+        processor->entry_word = entry;
+    }
+
+    return SUCCESS;
+}
+
+ProcessorStatus_t ExeFileToByteCode( Processor_t* processor, FileStat* file ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
     my_assert( file,      ASSERT_ERR_NULL_PTR );
 
     PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ )
 
-    file->size = DetermineFileSize( file->address );
+    bool is_binary = false;
+    ProcessorStatus_t status = MapBinaryExe( processor, file, &is_binary );
 
-    char* buffer = ReadToBuffer( file );
-    char* old_buffer_ptr = buffer;
+    if ( status == SUCCESS && !is_binary ) {
+        status = ReadTextExe( processor, file );  // Старый текстовый формат "count v v v ..."
+    }
 
-    int    number_of_characters_read = 0;
-    sscanf( buffer, "%lu%n", &( processor->instruction_count ), &number_of_characters_read );
-    buffer += number_of_characters_read;
+    if ( status == SUCCESS ) {
+        status = DecodeByteCode( processor );
+    }
 
-    // Every row have maximum 2 instructions, so max number of instructions is number of lines twice
-    processor->byte_code = ( int* ) calloc ( processor->instruction_count, sizeof( *processor->byte_code ) );
-    assert( processor->byte_code && "Memory allocation error \n" );
+    if ( status == SUCCESS ) {
+        status = VerifyByteCode( processor );
+    }
 
-    FillInByteCode( processor, buffer );
+    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
 
-    fprintf( stderr, "\n" );
+    return status;
+}
 
-    free( old_buffer_ptr );
+static const Command_t* FindCommand( int command ) {
+    const Opcode_t* opcode = FindOpcodeByCode( command );
 
-    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
+    return ( opcode ) ? commands + ( opcode - OPCODES ) : NULL;
+}
+
+ProcessorStatus_t DecodeByteCode( Processor_t* processor ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    size_t words_count = processor->instruction_count;
+    const int* byte_code = processor->byte_code;
+
+    // Номер инструкции по адресу слова байт-кода, SIZE_MAX - середина инструкции
+    size_t* index_of = ( size_t* ) calloc ( words_count + 1, sizeof( *index_of ) );
+    assert( index_of && "Memory allocation error \n" );
+
+    size_t code_size = 0;
+    for ( size_t word = 0; word < words_count; code_size++ ) {
+        index_of[ word ] = code_size;
+
+        const Command_t* command = FindCommand( byte_code[ word ] );
+        size_t args_number = ( command ) ? command->args_number : 0;
+
+        if ( word + args_number >= words_count ) {
+            fprintf( stderr, COLOR_RED "Missing argument of command %d at address %lu \n" COLOR_RESET,
+                     byte_code[ word ], word );
+            free( index_of );
+            return INVALID_EXE_CODE;
+        }
+
+        for ( size_t arg = 1; arg <= args_number; arg++ ) {
+            index_of[ word + arg ] = SIZE_MAX;
+        }
+
+        word += args_number + 1;
+    }
+    index_of[ words_count ] = code_size;
+
+    if ( processor->entry_word != 0 ) {
+        if ( processor->entry_word >= words_count || index_of[ processor->entry_word ] == SIZE_MAX ) {
+            fprintf( stderr, COLOR_RED "Incorrect entry point: address %lu \n" COLOR_RESET, processor->entry_word );
+            free( index_of );
+            return INVALID_EXE_CODE;
+        }
+
+        processor->instruction_ptr = index_of[ processor->entry_word ];
+    }
+
+    // Последняя инструкция - конец программы
+    Instr_t* code = ( Instr_t* ) calloc ( code_size + 1, sizeof( *code ) );
+    assert( code && "Memory allocation error \n" );
+
+    ProcessorStatus_t status = SUCCESS;
+
+    for ( size_t word = 0, i = 0; word < words_count; i++ ) {
+        int raw_command = byte_code[ word++ ];
+        const Command_t* command = FindCommand( raw_command );
+
+        code[i].command = raw_command;
+
+        if ( command == NULL ) {
+            continue;  // Ошибка будет выдана при исполнении, как и раньше
+        }
+
+        code[i].handler = command->handler;
+
+        if ( command->args_number == 0 ) {
+            continue;
+        }
+
+        int arg = byte_code[ word++ ];
+
+        switch ( command->operand ) {
+            case OPERAND_NUMBER:
+                code[i].imm = arg;
+                break;
+
+            // PUSHR, POPR и [регистр] у PUSHM, POPM; прежнее кодирование адреса числом + 100 сюда не проходит
+            case OPERAND_REGISTER:
+            case OPERAND_MEMORY:
+                if ( arg < 0 || arg >= REGS_NUMBER ) {
+                    fprintf( stderr, COLOR_RED "Incorrect register %d of command %d at address %lu \n" COLOR_RESET,
+                             arg, raw_command, word - 2 );
+                    status = INVALID_EXE_CODE;
+                }
+                code[i].reg = arg;
+                break;
+
+            // Адрес вне RAM - ошибка при исполнении, как и раньше
+            case OPERAND_ADDRESS:
+                code[i].addr = arg;
+                break;
+
+            case OPERAND_LABEL:  // Переходы и CALL
+                if ( arg < 0 || ( size_t ) arg >= words_count ) {
+                    code[i].target = code_size;  // Переход за конец программы завершает её
+                }
+                else if ( index_of[ arg ] == SIZE_MAX ) {
+                    fprintf( stderr, COLOR_RED "Jump to the middle of instruction: address %d \n" COLOR_RESET, arg );
+                    status = INVALID_EXE_CODE;
+                }
+                else {
+                    code[i].target = index_of[ arg ];
+                }
+                break;
+
+            case OPERAND_NONE:
+            default:
+                break;
+        }
+    }
+
+    free( index_of );
+
+    processor->code      = code;
+    processor->code_size = code_size;
+
+    PRINT( COLOR_BRIGHT_YELLOW "Decoded %lu words into %lu instructions \n", words_count, code_size )
+
+    return status;
 }
 
-void FillInByteCode( Processor_t* processor, char* buffer ) {
+// Прежний разбор через sscanf (-T): нужен только для сравнения скорости с ParseTextByteCode
+void FillInByteCode( Processor_t* processor, const char* buffer ) {
     my_assert( processor, ASSERT_ERR_NULL_PTR );
 
     int instruction = 0;
@@ -140,7 +599,7 @@ void FillInByteCode( Processor_t* processor, char* buffer ) {
 
     for ( size_t i = 0; i < processor->instruction_count; i++ ) {
         if ( sscanf( buffer, "%d %n", &instruction, &number_of_characters_read ) == 1 ) {
-            processor->byte_code[ i ] = instruction;
+            processor->text_code[ i ] = instruction;
             buffer += number_of_characters_read;
             PRINT( " %d", instruction )
         }
@@ -154,40 +613,58 @@ int ByteCodeProcessing( Processor_t* processor ) {
 
     ON_DEBUG( ProcDump( processor, 0 ) );
 
-    int command = 0;
-    while ( processor->instruction_ptr < processor->instruction_count ) {
-        command = processor->byte_code[ processor->instruction_ptr++ ];
-
-        switch ( command ) {
-            case PUSH_CMD:  ProcPush ( processor ); break;
-            case POP_CMD:   ProcPop  ( processor ); break;
-            case ADD_CMD:   ProcAdd  ( processor ); break;
-            case SUB_CMD:   ProcSub  ( processor ); break;
-            case MUL_CMD:   ProcMul  ( processor ); break;
-            case DIV_CMD:   ProcDiv  ( processor ); break;
-            case POW_CMD:   ProcPow  ( processor ); break;
-            case SQRT_CMD:  ProcSqrt ( processor ); break;
-            case IN_CMD:    ProcIn   ( processor ); break;
-            case OUT_CMD:   ProcOut  ( processor ); break;
-            case PUSHR_CMD: ProcPushR( processor ); break;
-            case POPR_CMD:  ProcPopR ( processor ); break;
-            case PUSHM_CMD: ProcPushM( processor ); break;
-            case POPM_CMD:  ProcPopM ( processor ); break;
-
-            case CALL_CMD:  ProcCall ( processor ); break;
-            case RET_CMD:   ProcRet  ( processor ); break;
-
-            case JMP_CMD:
-            case JE_CMD:
-            case JB_CMD:
-            case JA_CMD:
-            case JBE_CMD:
-            case JAE_CMD:   ProcJump( processor ); break;
+    while ( processor->instruction_ptr < processor->code_size ) {
+        const Instr_t* instr = &( processor->code[ processor->instruction_ptr++ ] );
+        processor->executed_count++;
+
+        switch ( instr->command ) {
+            case PUSH_CMD:      ProcPush    ( processor, instr ); break;
+            case POP_CMD:       ProcPop     ( processor, instr ); break;
+            case ADD_CMD:       ProcAdd     ( processor, instr ); break;
+            case SUB_CMD:       ProcSub     ( processor, instr ); break;
+            case MUL_CMD:       ProcMul     ( processor, instr ); break;
+            case DIV_CMD:       ProcDiv     ( processor, instr ); break;
+            case POW_CMD:       ProcPow     ( processor, instr ); break;
+            case SQRT_CMD:      ProcSqrt    ( processor, instr ); break;
+            case IN_CMD:        ProcIn      ( processor, instr ); break;
+            case OUT_CMD:       ProcOut     ( processor, instr ); break;
+            case PUSHR_CMD:     ProcPushR   ( processor, instr ); break;
+            case POPR_CMD:      ProcPopR    ( processor, instr ); break;
+            case PUSHM_CMD:     ProcPushM   ( processor, instr ); break;
+            case POPM_CMD:      ProcPopM    ( processor, instr ); break;
+            case PUSHMA_CMD:    ProcPushMAbs( processor, instr ); break;
+            case POPMA_CMD:     ProcPopMAbs ( processor, instr ); break;
+            case MEMSET_CMD:    ProcMemset  ( processor, instr ); break;
+            case MEMCPY_CMD:    ProcMemcpy  ( processor, instr ); break;
+            case MEMCMP_CMD:    ProcMemcmp  ( processor, instr ); break;
+            case VADD_CMD:      ProcVadd    ( processor, instr ); break;
+            case VMUL_CMD:      ProcVmul    ( processor, instr ); break;
+            case VSUM_CMD:      ProcVsum    ( processor, instr ); break;
+            case VDOT_CMD:      ProcVdot    ( processor, instr ); break;
+
+            case CALL_CMD:      ProcCall    ( processor, instr ); break;
+            case RET_CMD:       ProcRet     ( processor, instr ); break;
+
+            case JMP_CMD:       ProcJmp     ( processor, instr ); break;
+            case JE_CMD:        ProcJe      ( processor, instr ); break;
+            case JB_CMD:        ProcJb      ( processor, instr ); break;
+            case JA_CMD:        ProcJa      ( processor, instr ); break;
+            case JBE_CMD:       ProcJbe     ( processor, instr ); break;
+            case JAE_CMD:       ProcJae     ( processor, instr ); break;
+
+            case REG_ADD_IMM_CMD: ProcRegAddImm ( processor, instr ); break;
+            case JB_REG_IMM_CMD:  ProcJbRegImm  ( processor, instr ); break;
+            case JA_REG_IMM_CMD:  ProcJaRegImm  ( processor, instr ); break;
+            case JBE_REG_IMM_CMD: ProcJbeRegImm ( processor, instr ); break;
+            case JAE_REG_IMM_CMD: ProcJaeRegImm ( processor, instr ); break;
+            case JE_REG_IMM_CMD:  ProcJeRegImm  ( processor, instr ); break;
+            case LOAD_CONST_CMD:  ProcLoadConst ( processor, instr ); break;
+            case STORE_CONST_CMD: ProcStoreConst( processor, instr ); break;
 
             case HLT_CMD:   return 0;
 
             default:
-                fprintf( stderr, COLOR_RED "Incorrect command %d \n" COLOR_RESET, *( processor->byte_code ) );
+                fprintf( stderr, COLOR_RED "Incorrect command %d \n" COLOR_RESET, instr->command );
                 return 1;
         }
 
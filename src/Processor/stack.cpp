@@ -10,8 +10,9 @@ void StackCtor( Stack_t* stk, size_t capacity ) {
     stk->data = ( int* ) calloc ( capacity ON_CANARY( + 2 ), sizeof( StackData_t ) );
     assert( stk->data != NULL );
 
-    stk->capacity = capacity;
-    stk->size     = 0;
+    stk->capacity     = capacity;
+    stk->size         = 0;
+    stk->min_capacity = capacity;
 
     #ifdef _CANARY
         *( stk->data ) = canary;
@@ -20,7 +21,7 @@ void StackCtor( Stack_t* stk, size_t capacity ) {
         stk->data++;
     #endif
 
-    StackToPoison( stk );
+    ON_DEBUG( StackToPoison( stk, 0 ); )
 }
 
 void StackDtor( Stack_t* stk ) {
@@ -38,7 +39,7 @@ void StackPush( Stack_t* stk, int element ) {
     // PRINT( "%s %d \n", __func__, element )
     DEBUG_IN_FUNC(
         if ( stk->size == stk->capacity ) {
-            StackRealloc( stk, stk->capacity * 2 );
+            StackRealloc( stk, StackGrownCapacity( stk->capacity ) );
         }
 
         *( stk->data + stk->size ) = element;
@@ -50,10 +51,15 @@ void StackPop( Stack_t* stk ) {
     // PRINT( "%s \n", __func__ )
     DEBUG_IN_FUNC(
         stk->size--;
-        *( stk->data + stk->size ) = poison;
+        ON_DEBUG(
+            *( stk->data + stk->size ) = poison;
+            stk->poison_count++;
+        )
 
-        if ( stk->size * 4 <= stk->capacity && stk->size != 0 ) {
-            StackRealloc( stk, stk->capacity / 2 + 1 );
+        // Гистерезис: после сжатия вдвое стек заполнен не больше чем наполовину,
+        // поэтому до следующего роста нужно столько же PUSH, сколько сейчас элементов свободно
+        if ( !stk->never_shrink && stk->size * 4 <= stk->capacity && stk->capacity / 2 >= stk->min_capacity ) {
+            StackRealloc( stk, stk->capacity / 2 );
         }
     )
 }
@@ -72,7 +78,10 @@ StackData_t StackTop( Stack_t* stk ) {
 
 void StackRealloc( Stack_t* stk, size_t capacity ) {
     // DEBUG_IN_FUNC(
+        ON_DEBUG( size_t old_capacity = stk->capacity; )
+
         stk->capacity = capacity;
+        stk->realloc_count++;
         ON_CANARY( stk->data--; )
 
         StackData_t* new_ptr = ( int* ) realloc ( stk->data, ( capacity ON_CANARY( + 2 ) ) * sizeof( StackData_t ) );
@@ -86,14 +95,16 @@ void StackRealloc( Stack_t* stk, size_t capacity ) {
             stk->data++;
         #endif
 
-        StackToPoison( stk );
+        // Свободные ячейки до old_capacity уже отравлены при StackPop, новые - нет
+        ON_DEBUG( StackToPoison( stk, old_capacity ); )
     // )
 }
 
-void StackToPoison( Stack_t* stk ) {
+void StackToPoison( Stack_t* stk, size_t from ) {
     DEBUG_IN_FUNC(
-        for ( size_t i = stk->size; i < stk->capacity; i++ ) {
+        for ( size_t i = ( from > stk->size ) ? from : stk->size; i < stk->capacity; i++ ) {
             *( stk->data + i ) = poison;
+            stk->poison_count++;
         }
     )
 }
@@ -0,0 +1,420 @@
+#include "processor.h"
+
+// Основной стек держим в локальных переменных, в структуру он записывается только
+// перед вызовом внешних функций (IN/OUT) и при выходе.
+//
+// В режиме кэширования вершины ( tos_cache == true ) верхний элемент живет в локальной
+// переменной tos, а в памяти лежат только элементы под ним: data[ size - 1 ] не актуален.
+// Память трогается, только когда вершину нужно вытеснить (PUSH) или подгрузить (POP).
+// Ячейка для вытеснения - UNDER_TOP: на пустом стеке это свободная data[0], поэтому ветвления нет.
+//
+// Проверенной верификатором программе ( fast == true ) стек заранее выделен на наибольшую глубину:
+// PUSH не сравнивает размер с емкостью, прямые адреса RAM не проверяются - их проверил VerifyByteCode.
+#define UNDER_TOP     data[ size - ( size != 0 ) ]
+
+#define SYNC_STACK()                                            \
+    stk->size = size;                                           \
+    if constexpr ( tos_cache ) {                                \
+        UNDER_TOP = tos;                                        \
+    }
+
+#define LOAD_STACK()                                            \
+    data = stk->data; size = stk->size; capacity = stk->capacity; \
+    if constexpr ( tos_cache ) {                                \
+        tos = UNDER_TOP;                                        \
+    }
+
+#define PUSH_VALUE( value )                                     \
+    {                                                           \
+        StackData_t pushed = ( value );                         \
+        if ( !fast && size == capacity ) {                      \
+            SYNC_STACK()                                        \
+            StackRealloc( stk, StackGrownCapacity( capacity ) ); \
+            data = stk->data; capacity = stk->capacity;         \
+        }                                                       \
+        if constexpr ( tos_cache ) {                            \
+            UNDER_TOP = tos;                                    \
+            tos = pushed;                                       \
+            size++;                                             \
+        } else {                                                \
+            data[ size++ ] = pushed;                            \
+        }                                                       \
+    }
+
+#define POP_TO( variable )                                      \
+    if constexpr ( tos_cache ) {                                \
+        variable = tos;                                         \
+        size--;                                                 \
+        tos = UNDER_TOP;                                        \
+    } else {                                                    \
+        variable = data[ --size ];                              \
+    }
+
+#define DROP_VALUE()                                            \
+    size--;                                                     \
+    if constexpr ( tos_cache ) {                                \
+        tos = UNDER_TOP;                                        \
+    }
+
+#define TOP_VALUE()   ( tos_cache ? tos : data[ size - 1 ] )
+
+#define DISPATCH()    executed++; goto *( ip->label );
+
+#define CONDITIONAL_JUMP( condition )                       \
+    {                                                       \
+        StackData_t b = 0;                                  \
+        StackData_t a = 0;                                  \
+        POP_TO( b )                                         \
+        POP_TO( a )                                         \
+        ip = ( condition ) ? code + ip->target : ip + 1;    \
+        DISPATCH()                                          \
+    }
+
+#define CONDITIONAL_JUMP_REG_IMM( condition )               \
+    {                                                       \
+        StackData_t a = regs[ ip->reg ];                    \
+        StackData_t b = ip->imm;                            \
+        ip = ( condition ) ? code + ip->target              \
+                           : ip + JCC_REG_IMM_LEN;          \
+        DISPATCH()                                          \
+    }
+
+// VADD, VMUL: снимаем len, b, a, dst
+#define VECTOR_BINARY( kernel )                             \
+    {                                                       \
+        StackData_t len = 0;                                \
+        StackData_t b   = 0;                                \
+        StackData_t a   = 0;                                \
+        StackData_t dst = 0;                                \
+        POP_TO( len )                                       \
+        POP_TO( b )                                         \
+        POP_TO( a )                                         \
+        POP_TO( dst )                                       \
+        CheckRamRange( ram_size, a,   len );                \
+        CheckRamRange( ram_size, b,   len );                \
+        CheckRamRange( ram_size, dst, len );                \
+        kernel( RAM + dst, RAM + a, RAM + b, ( size_t ) len ); \
+        ip++;                                               \
+        DISPATCH()                                          \
+    }
+
+static inline int CheckedRamIndex( int ram_index, size_t ram_size ) {
+    if ( ram_index < 0 || ( size_t ) ram_index >= ram_size ) {
+        fprintf( stderr, COLOR_RED "RAM index out of bounds: %d" COLOR_RESET "\n", ram_index );
+        assert( 0 && "RAM access violation" );
+    }
+
+    return ram_index;
+}
+
+// Прямой адрес RAM ( PUSHM 5 ): в проверенной программе он заведомо внутри RAM
+#define CONST_RAM_INDEX( addr ) ( ( fast ) ? ( addr ) : CheckedRamIndex( ( addr ), ram_size ) )
+
+template <bool tos_cache, bool fast>
+static int RunThreaded( Processor_t* processor ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR )
+
+    PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ );
+
+    const void* handlers[ COMMANDS_NUMBER ] = {};
+    for ( int i = 0; i < COMMANDS_NUMBER; i++ ) {
+        handlers[i] = &&incorrect_command;
+    }
+
+    handlers[ PUSH_CMD      ] = &&push;       handlers[ POP_CMD      ] = &&pop;
+    handlers[ ADD_CMD       ] = &&add;        handlers[ SUB_CMD      ] = &&sub;
+    handlers[ MUL_CMD       ] = &&mul;        handlers[ DIV_CMD      ] = &&div;
+    handlers[ POW_CMD       ] = &&pow;        handlers[ SQRT_CMD     ] = &&sqrt;
+    handlers[ IN_CMD        ] = &&in;         handlers[ OUT_CMD      ] = &&out;
+    handlers[ PUSHR_CMD     ] = &&pushr;      handlers[ POPR_CMD     ] = &&popr;
+    handlers[ PUSHM_CMD     ] = &&pushm;      handlers[ POPM_CMD     ] = &&popm;
+    handlers[ PUSHMA_CMD    ] = &&pushm_abs;  handlers[ POPMA_CMD    ] = &&popm_abs;
+    handlers[ MEMSET_CMD    ] = &&memset;     handlers[ MEMCPY_CMD   ] = &&memcpy;
+    handlers[ MEMCMP_CMD    ] = &&memcmp;
+    handlers[ VADD_CMD      ] = &&vadd;       handlers[ VMUL_CMD     ] = &&vmul;
+    handlers[ VSUM_CMD      ] = &&vsum;       handlers[ VDOT_CMD     ] = &&vdot;
+    handlers[ JMP_CMD       ] = &&jmp;        handlers[ JE_CMD       ] = &&je;
+    handlers[ JB_CMD        ] = &&jb;         handlers[ JA_CMD       ] = &&ja;
+    handlers[ JBE_CMD       ] = &&jbe;        handlers[ JAE_CMD      ] = &&jae;
+    handlers[ CALL_CMD      ] = &&call;       handlers[ RET_CMD      ] = &&ret;
+    handlers[ HLT_CMD       ] = &&hlt;
+
+    handlers[ REG_ADD_IMM_CMD ] = &&reg_add_imm;
+    handlers[ JB_REG_IMM_CMD  ] = &&jb_reg_imm;   handlers[ JA_REG_IMM_CMD  ] = &&ja_reg_imm;
+    handlers[ JBE_REG_IMM_CMD ] = &&jbe_reg_imm;  handlers[ JAE_REG_IMM_CMD ] = &&jae_reg_imm;
+    handlers[ JE_REG_IMM_CMD  ] = &&je_reg_imm;
+    handlers[ LOAD_CONST_CMD  ] = &&load_const;   handlers[ STORE_CONST_CMD ] = &&store_const;
+
+    Instr_t* code  = processor->code;
+    size_t   count = processor->code_size;
+
+    // Связываем каждую инструкцию с адресом её обработчика - дальше диспетчеризация идет без таблицы
+    for ( size_t i = 0; i < count; i++ ) {
+        int command = code[i].command;
+        code[i].label = ( command >= 0 && command < COMMANDS_NUMBER ) ? handlers[ command ] : &&incorrect_command;
+    }
+    code[ count ].label = &&end;
+
+    Stack_t*     stk      = &( processor->stk );
+    StackData_t* data     = NULL;
+    size_t       size     = 0;
+    size_t       capacity = 0;
+    StackData_t  tos      = 0;
+    LOAD_STACK()
+
+    StackData_t* regs     = processor->regs;
+    int*         RAM      = processor->RAM;
+    size_t       ram_size = processor->ram_size;
+    size_t       executed = 0;
+    Instr_t*     ip       = code + processor->instruction_ptr;
+    int          result   = 0;
+
+    DISPATCH()
+
+    push:
+        PUSH_VALUE( ip->imm )
+        ip++;
+        DISPATCH()
+
+    pop:
+        DROP_VALUE()
+        ip++;
+        DISPATCH()
+
+    add:
+        { StackData_t b = 0; POP_TO( b ) TOP_VALUE() = TOP_VALUE() + b; }
+        ip++;
+        DISPATCH()
+
+    sub:
+        { StackData_t b = 0; POP_TO( b ) TOP_VALUE() = TOP_VALUE() - b; }
+        ip++;
+        DISPATCH()
+
+    mul:
+        { StackData_t b = 0; POP_TO( b ) TOP_VALUE() = TOP_VALUE() * b; }
+        ip++;
+        DISPATCH()
+
+    div:
+        {
+            StackData_t b = 0;
+            POP_TO( b )
+            assert( b != 0 );
+            TOP_VALUE() = TOP_VALUE() / b;
+        }
+        ip++;
+        DISPATCH()
+
+    pow:
+        {
+            StackData_t indicator = 0;
+            POP_TO( indicator )
+            StackData_t base      = TOP_VALUE();
+            StackData_t power     = 1;
+
+            for ( int i = 0; i < indicator; i++ ) {
+                power *= base;
+            }
+
+            TOP_VALUE() = power;
+        }
+        ip++;
+        DISPATCH()
+
+    sqrt:
+        TOP_VALUE() = ( int ) sqrt( TOP_VALUE() );
+        ip++;
+        DISPATCH()
+
+    in:
+        SYNC_STACK()
+        ProcIn( processor, ip );
+        LOAD_STACK()
+        ip++;
+        DISPATCH()
+
+    out:
+        SYNC_STACK()
+        ProcOut( processor, ip );
+        LOAD_STACK()
+        ip++;
+        DISPATCH()
+
+    pushr:
+        PUSH_VALUE( regs[ ip->reg ] )
+        ip++;
+        DISPATCH()
+
+    popr:
+        POP_TO( regs[ ip->reg ] )
+        ip++;
+        DISPATCH()
+
+    pushm:
+        PUSH_VALUE( RAM[ CheckedRamIndex( regs[ ip->reg ], ram_size ) ] )
+        ip++;
+        DISPATCH()
+
+    popm:
+        {
+            int ram_index = CheckedRamIndex( regs[ ip->reg ], ram_size );
+            POP_TO( RAM[ ram_index ] )
+        }
+        ip++;
+        DISPATCH()
+
+    pushm_abs:
+        PUSH_VALUE( RAM[ CONST_RAM_INDEX( ip->addr ) ] )
+        ip++;
+        DISPATCH()
+
+    popm_abs:
+        POP_TO( RAM[ CONST_RAM_INDEX( ip->addr ) ] )
+        ip++;
+        DISPATCH()
+
+    memset:
+        {
+            StackData_t words = 0;
+            StackData_t value = 0;
+            StackData_t dst   = 0;
+            POP_TO( words )
+            POP_TO( value )
+            POP_TO( dst )
+            CheckRamRange( ram_size, dst, words );
+            RamFill( RAM + dst, value, ( size_t ) words );
+        }
+        ip++;
+        DISPATCH()
+
+    memcpy:
+        {
+            StackData_t words = 0;
+            StackData_t src   = 0;
+            StackData_t dst   = 0;
+            POP_TO( words )
+            POP_TO( src )
+            POP_TO( dst )
+            CheckRamRange( ram_size, src, words );
+            CheckRamRange( ram_size, dst, words );
+            RamCopy( RAM + dst, RAM + src, ( size_t ) words );
+        }
+        ip++;
+        DISPATCH()
+
+    memcmp:
+        {
+            StackData_t words = 0;
+            StackData_t b     = 0;
+            POP_TO( words )
+            POP_TO( b )
+            StackData_t a = TOP_VALUE();
+            CheckRamRange( ram_size, a, words );
+            CheckRamRange( ram_size, b, words );
+            TOP_VALUE() = RamCompare( RAM + a, RAM + b, ( size_t ) words );
+        }
+        ip++;
+        DISPATCH()
+
+    vadd: VECTOR_BINARY( RamVectorAdd )
+    vmul: VECTOR_BINARY( RamVectorMul )
+
+    vsum:
+        {
+            StackData_t len = 0;
+            POP_TO( len )
+            CheckRamRange( ram_size, TOP_VALUE(), len );
+            TOP_VALUE() = RamVectorSum( RAM + TOP_VALUE(), ( size_t ) len );
+        }
+        ip++;
+        DISPATCH()
+
+    vdot:
+        {
+            StackData_t len = 0;
+            StackData_t b   = 0;
+            POP_TO( len )
+            POP_TO( b )
+            StackData_t a = TOP_VALUE();
+            CheckRamRange( ram_size, a, len );
+            CheckRamRange( ram_size, b, len );
+            TOP_VALUE() = RamVectorDot( RAM + a, RAM + b, ( size_t ) len );
+        }
+        ip++;
+        DISPATCH()
+
+    jmp:
+        ip = code + ip->target;
+        DISPATCH()
+
+    je:  CONDITIONAL_JUMP( a == b )
+    jb:  CONDITIONAL_JUMP( a <  b )
+    ja:  CONDITIONAL_JUMP( a >  b )
+    jbe: CONDITIONAL_JUMP( a <= b )
+    jae: CONDITIONAL_JUMP( a >= b )
+
+    call:
+        StackPush( &( processor->refund_stk ), ( int ) ( ip - code + 1 ) );
+        ip = code + ip->target;
+        DISPATCH()
+
+    ret:
+        {
+            size_t index = ( size_t ) StackTop( &( processor->refund_stk ) );
+            StackPop( &( processor->refund_stk ) );
+
+            ip = code + ( ( index < count ) ? index : count );
+        }
+        DISPATCH()
+
+    reg_add_imm:
+        regs[ ip->reg ] = regs[ ip->reg ] + ip->imm;
+        ip += REG_ADD_IMM_LEN;
+        DISPATCH()
+
+    jb_reg_imm:  CONDITIONAL_JUMP_REG_IMM( a <  b )
+    ja_reg_imm:  CONDITIONAL_JUMP_REG_IMM( a >  b )
+    jbe_reg_imm: CONDITIONAL_JUMP_REG_IMM( a <= b )
+    jae_reg_imm: CONDITIONAL_JUMP_REG_IMM( a >= b )
+    je_reg_imm:  CONDITIONAL_JUMP_REG_IMM( a == b )
+
+    load_const:
+        regs[ ip->reg ] = ip->addr;
+        PUSH_VALUE( RAM[ ip->addr ] )
+        ip += CONST_RAM_LEN;
+        DISPATCH()
+
+    store_const:
+        regs[ ip->reg ] = ip->addr;
+        POP_TO( RAM[ ip->addr ] )
+        ip += CONST_RAM_LEN;
+        DISPATCH()
+
+    incorrect_command:
+        fprintf( stderr, COLOR_RED "Incorrect command %d \n" COLOR_RESET, ip->command );
+        result = 1;
+        goto exit;
+
+    end:
+        executed--;  // Выход за конец программы - не инструкция
+        goto exit;
+
+    hlt:
+    exit:
+        SYNC_STACK()
+        processor->instruction_ptr = ( size_t ) ( ip - code );
+        processor->executed_count += executed;
+
+    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
+
+    return result;
+}
+
+int ByteCodeProcessingThreaded( Processor_t* processor ) {
+    return ( processor->fast ) ? RunThreaded<false, true>( processor ) : RunThreaded<false, false>( processor );
+}
+
+int ByteCodeProcessingTos( Processor_t* processor ) {
+    return ( processor->fast ) ? RunThreaded<true, true>( processor ) : RunThreaded<true, false>( processor );
+}
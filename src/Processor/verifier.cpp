@@ -0,0 +1,257 @@
+#include "processor.h"
+
+// Верификатор декодированного потока ( до FuseInstructions ). Номера регистров и цели переходов
+// уже проверил DecodeByteCode, здесь по графу потока управления вычисляется глубина стека
+// перед каждой инструкцией. Глубина распространяется от точки входа списком работ: у условного
+// перехода преемники - цель и следующая инструкция, у CALL - начало функции с той же глубиной,
+// у RET - все точки возврата ( инструкции после CALL ). Снимаемые и кладущиеся значения берутся из OPCODES.
+//
+// Если в одну инструкцию приходят разные глубины ( стек растет в цикле, функция вызывается
+// на разной глубине ), ее глубина - DEPTH_DIFFERS, и это распространяется на всех ее преемников.
+//
+// Программа отвергается, если:
+//     - команде с одной глубиной на всех путях не хватает значений на стеке - где-то в программе
+//       глубины могут расходиться, нехватка на таком пути от этого не перестает быть ошибкой;
+//     - RET достижим без CALL ( стек возврата пуст );
+//     - достижимая PUSHM/POPM с прямым адресом выходит за RAM.
+// Программа с DEPTH_DIFFERS не проверена: она исполняется с проверками роста стека, как раньше
+// ( опустошение стека при исполнении не проверяет ни один движок ).
+// Проверенная программа не превышает max_stack_depth - стек заранее получает эту емкость.
+
+const long DEPTH_UNKNOWN = -1;  // Инструкция еще не достигнута
+const long DEPTH_DIFFERS = -2;  // На разных путях разные глубины
+
+struct Verifier_t {
+    Processor_t* processor     = NULL;
+    size_t*      word_of       = NULL;  // Адрес слова байт-кода каждой инструкции ( для диагностики )
+    long*        depth         = NULL;  // Глубина стека перед инструкцией, DEPTH_UNKNOWN - не достигнута
+    size_t*      worklist      = NULL;
+    size_t       pending       = 0;
+    bool*        queued        = NULL;  // Инструкция уже в worklist
+    size_t*      returns       = NULL;  // Точки возврата: инструкции после CALL
+    size_t       returns_count = 0;
+};
+
+static bool IsConditionalJump( int command ) {
+    return command == JB_CMD || command == JA_CMD || command == JBE_CMD || command == JAE_CMD || command == JE_CMD;
+}
+
+// Глубина depth приходит в инструкцию index: неизвестная становится depth, другая точная - DEPTH_DIFFERS.
+// Каждая глубина меняется не больше двух раз, поэтому список работ конечен.
+// Переход за конец программы ее завершает: у такого пути преемника нет
+static void Propagate( Verifier_t* verifier, size_t index, long depth ) {
+    Processor_t* processor = verifier->processor;
+    if ( index >= processor->code_size ) return;
+
+    long old_depth = verifier->depth[ index ];
+    long new_depth = ( old_depth == DEPTH_UNKNOWN || old_depth == depth ) ? depth : DEPTH_DIFFERS;
+
+    if ( new_depth == old_depth ) return;
+
+    // Первое расхождение точных глубин запоминаем для статистики
+    if ( old_depth >= 0 && depth >= 0 && processor->unverified_word == SIZE_MAX ) {
+        processor->unverified_word = verifier->word_of[ index ];
+
+        PRINT( "Stack depth %ld and %ld meet at address %lu \n", old_depth, depth, verifier->word_of[ index ] )
+    }
+
+    verifier->depth[ index ] = new_depth;
+
+    if ( !verifier->queued[ index ] ) {
+        verifier->queued[ index ] = true;
+        verifier->worklist[ verifier->pending++ ] = index;
+    }
+}
+
+// Путь без вызовов от точки входа: CALL на нем считается вернувшимся, RET - ошибка
+static ProcessorStatus_t CheckReturns( const Verifier_t* verifier ) {
+    const Processor_t* processor = verifier->processor;
+    const Instr_t*     code      = processor->code;
+    size_t             code_size = processor->code_size;
+
+    bool*   seen     = ( bool*   ) calloc ( code_size + 1, sizeof( *seen     ) );
+    size_t* worklist = ( size_t* ) calloc ( code_size + 1, sizeof( *worklist ) );
+    assert( seen && worklist && "Memory allocation error \n" );
+
+    ProcessorStatus_t status = SUCCESS;
+    size_t pending = 0;
+
+    if ( processor->instruction_ptr < code_size ) {
+        seen[ processor->instruction_ptr ] = true;
+        worklist[ pending++ ] = processor->instruction_ptr;
+    }
+
+    while ( pending > 0 && status == SUCCESS ) {
+        size_t index = worklist[ --pending ];
+        int command  = code[ index ].command;
+
+        size_t next[2] = { index + 1, code_size };
+        if      ( command == RET_CMD ) {
+            fprintf( stderr, COLOR_RED "RET without CALL at address %lu \n" COLOR_RESET, verifier->word_of[ index ] );
+            status = INVALID_EXE_CODE;
+            continue;
+        }
+        else if ( command == JMP_CMD )               next[0] = code[ index ].target;
+        else if ( IsConditionalJump( command ) )     next[1] = code[ index ].target;
+        else if ( command == HLT_CMD || FindOpcodeByCode( command ) == NULL ) continue;
+
+        for ( size_t i = 0; i < 2; i++ ) {
+            if ( next[i] < code_size && !seen[ next[i] ] ) {
+                seen[ next[i] ] = true;
+                worklist[ pending++ ] = next[i];
+            }
+        }
+    }
+
+    free( seen );
+    free( worklist );
+
+    return status;
+}
+
+static ProcessorStatus_t PropagateDepths( Verifier_t* verifier ) {
+    Processor_t*   processor = verifier->processor;
+    const Instr_t* code      = processor->code;
+    size_t         code_size = processor->code_size;
+
+    ProcessorStatus_t status = SUCCESS;
+
+    Propagate( verifier, processor->instruction_ptr, 0 );
+
+    while ( verifier->pending > 0 && status == SUCCESS ) {
+        size_t         index = verifier->worklist[ --verifier->pending ];
+        const Instr_t* instr = code + index;
+        long           depth = verifier->depth[ index ];
+
+        verifier->queued[ index ] = false;
+
+        const Opcode_t* opcode = FindOpcodeByCode( instr->command );
+        if ( opcode == NULL ) continue;  // Неизвестная команда - ошибка при исполнении, путь обрывается
+
+        // Нехватку значений ищет проход после распространения: глубина еще может стать DEPTH_DIFFERS
+        if ( depth != DEPTH_DIFFERS && depth < ( long ) opcode->pops ) continue;
+
+        if ( ( instr->command == PUSHMA_CMD || instr->command == POPMA_CMD ) &&
+             ( instr->addr < 0 || ( size_t ) instr->addr >= processor->ram_size ) ) {
+            fprintf( stderr, COLOR_RED "RAM address %d of %s at address %lu is out of RAM ( %lu words ) \n" COLOR_RESET,
+                     instr->addr, opcode->name, verifier->word_of[ index ], processor->ram_size );
+            status = INVALID_EXE_CODE;
+            continue;
+        }
+
+        long after = ( depth == DEPTH_DIFFERS ) ? DEPTH_DIFFERS : depth - ( long ) opcode->pops + ( long ) opcode->pushes;
+
+        switch ( instr->command ) {
+            case HLT_CMD:
+                break;
+
+            case JMP_CMD:
+            case CALL_CMD:
+                Propagate( verifier, instr->target, after );
+                break;
+
+            case RET_CMD:
+                for ( size_t i = 0; i < verifier->returns_count; i++ ) {
+                    Propagate( verifier, verifier->returns[i], after );
+                }
+                break;
+
+            default:
+                if ( IsConditionalJump( instr->command ) ) Propagate( verifier, instr->target, after );
+                Propagate( verifier, index + 1, after );
+                break;
+        }
+    }
+
+    if ( status != SUCCESS ) return status;
+
+    // Точная глубина одна на всех путях в инструкцию: нехватка на ней - ошибка при любом исполнении, дошедшем туда
+    for ( size_t i = 0; i < code_size; i++ ) {
+        const Opcode_t* opcode = FindOpcodeByCode( code[i].command );
+        long            depth  = verifier->depth[i];
+
+        if ( opcode == NULL || depth < 0 ) continue;
+
+        if ( depth < ( long ) opcode->pops ) {
+            fprintf( stderr, COLOR_RED "Stack underflow: %s at address %lu needs %lu values, stack has %ld \n" COLOR_RESET,
+                     opcode->name, verifier->word_of[i], opcode->pops, depth );
+            return INVALID_EXE_CODE;
+        }
+
+        size_t after = ( size_t ) ( depth - ( long ) opcode->pops + ( long ) opcode->pushes );
+        if ( after > processor->max_stack_depth ) processor->max_stack_depth = after;
+    }
+
+    processor->verified = ( processor->unverified_word == SIZE_MAX );
+
+    return status;
+}
+
+ProcessorStatus_t VerifyByteCode( Processor_t* processor ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+
+    PRINT( COLOR_BRIGHT_YELLOW "In %s \n", __func__ )
+
+    size_t code_size = processor->code_size;
+
+    processor->verified        = false;
+    processor->max_stack_depth = 0;
+    processor->unverified_word = SIZE_MAX;
+
+    Verifier_t verifier = {};
+    verifier.processor = processor;
+    verifier.word_of   = ( size_t* ) calloc ( code_size + 1, sizeof( *verifier.word_of  ) );
+    verifier.depth     = ( long*   ) calloc ( code_size + 1, sizeof( *verifier.depth    ) );
+    verifier.worklist  = ( size_t* ) calloc ( code_size + 1, sizeof( *verifier.worklist ) );
+    verifier.returns   = ( size_t* ) calloc ( code_size + 1, sizeof( *verifier.returns  ) );
+    verifier.queued    = ( bool*   ) calloc ( code_size + 1, sizeof( *verifier.queued   ) );
+    assert( verifier.word_of && verifier.depth && verifier.worklist && verifier.returns && verifier.queued &&
+            "Memory allocation error \n" );
+
+    // Адреса слов восстанавливаются по размерам команд так же, как их прошел DecodeByteCode
+    for ( size_t i = 0, word = 0; i < code_size; i++ ) {
+        const Opcode_t* opcode = FindOpcodeByCode( processor->code[i].command );
+
+        verifier.word_of[i] = word;
+        verifier.depth[i]   = DEPTH_UNKNOWN;
+        if ( processor->code[i].command == CALL_CMD ) {
+            verifier.returns[ verifier.returns_count++ ] = i + 1;
+        }
+
+        word += ( opcode ) ? opcode->size : 1;
+    }
+
+    ProcessorStatus_t status = CheckReturns( &verifier );
+    if ( status == SUCCESS ) {
+        status = PropagateDepths( &verifier );
+    }
+
+    free( verifier.word_of );
+    free( verifier.depth );
+    free( verifier.worklist );
+    free( verifier.returns );
+    free( verifier.queued );
+
+    PRINT( "Verified = %d; max stack depth = %lu \n", processor->verified, processor->max_stack_depth )
+    PRINT( COLOR_BRIGHT_YELLOW "Out %s \n", __func__ )
+
+    return status;
+}
+
+void ReserveVerifiedStack( Processor_t* processor ) {
+    my_assert( processor, ASSERT_ERR_NULL_PTR );
+    assert( processor->verified );
+
+    Stack_t* stk = &( processor->stk );
+
+    // Шитый движок с кэшем вершины пишет data[0] и на пустом стеке
+    size_t capacity = ( processor->max_stack_depth > 0 ) ? processor->max_stack_depth : 1;
+
+    if ( stk->capacity < capacity ) {
+        StackRealloc( stk, capacity );
+    }
+
+    // Обработчики Proc* ( IN, OUT, обратные вызовы JIT ) снимают значения через StackPop:
+    // сжатие оставило бы стеку меньше max_stack_depth
+    stk->never_shrink = true;
+}
@@ -0,0 +1,46 @@
+#!/bin/sh
+
+# Кэш ассемблера ( -c ): повторный запуск берет выход из кэша и он совпадает с ассемблированным заново,
+# измененный исходник и другой формат вывода - промахи, сверх лимита ( -l ) вытесняется давно использованное.
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh
+
+WORK_DIR=$( mktemp -d )
+CACHE="$WORK_DIR/cache"
+FAILED=0
+
+expect() {
+    result=$( ./assembler "$@" -c "$CACHE" -s 2>&1 | grep -o "^Cache [a-z]*" )
+    [ "$result" = "Cache $EXPECTED" ] || { echo "FAIL: $* - expected cache $EXPECTED, got \"$result\""; FAILED=1; }
+}
+
+for program in ./tests/*.txt; do
+    name=$( basename "$program" .txt )
+    ./assembler -i "$program" -o "$WORK_DIR/$name.ref" > /dev/null 2>&1
+
+    EXPECTED=miss expect -i "$program" -o "$WORK_DIR/$name.bin"
+    EXPECTED=hit  expect -i "$program" -o "$WORK_DIR/$name.bin"
+    EXPECTED=miss expect -i "$program" -o "$WORK_DIR/$name.code" -f text
+
+    cmp -s "$WORK_DIR/$name.ref" "$WORK_DIR/$name.bin" || { echo "FAIL $name: cached output differs"; FAILED=1; }
+done
+
+cp ./tests/factorial.txt "$WORK_DIR/changed.txt"
+printf "\nHLT\n" >> "$WORK_DIR/changed.txt"
+EXPECTED=miss expect -i "$WORK_DIR/changed.txt" -o "$WORK_DIR/changed.bin"
+
+# Три выхода по ~0.4 МБ в кэше на 1 МБ: после использования первого вытесняется второй
+for i in 1 2 3; do
+    awk -v n="$i" 'BEGIN { for ( k = 0; k < 50000; k++ ) print "PUSH " k + n; print "HLT" }' > "$WORK_DIR/big$i.txt"
+done
+
+EXPECTED=miss expect -i "$WORK_DIR/big1.txt" -o "$WORK_DIR/big.bin" -l 1
+EXPECTED=miss expect -i "$WORK_DIR/big2.txt" -o "$WORK_DIR/big.bin" -l 1
+EXPECTED=hit  expect -i "$WORK_DIR/big1.txt" -o "$WORK_DIR/big.bin" -l 1
+EXPECTED=miss expect -i "$WORK_DIR/big3.txt" -o "$WORK_DIR/big.bin" -l 1
+EXPECTED=hit  expect -i "$WORK_DIR/big1.txt" -o "$WORK_DIR/big.bin" -l 1
+EXPECTED=miss expect -i "$WORK_DIR/big2.txt" -o "$WORK_DIR/big.bin" -l 1
+
+rm -r "$WORK_DIR"
+
+[ $FAILED -eq 0 ] && echo "Cache works"
+exit $FAILED
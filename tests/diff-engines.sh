@@ -0,0 +1,125 @@
+#!/bin/sh
+
+# Дифференциальный тест движков: каждая программа из tests/ на нескольких наборах ввода,
+# с суперинструкциями и без (-F), со скалярными векторными ядрами (-V) и с проверками стека
+# у проверенной верификатором программы (-C); вывод каждого движка сравнивается с эталонным switch.
+# Эталон загружается из текстового формата ( -f text ), остальные движки - из двоичного.
+# Если есть компилятор C ($CC, по умолчанию cc), так же проверяется программа из ассемблера с -f c.
+# Пакетный режим ( -b ) всех наборов ввода сравнивается с отдельными запусками.
+# Байт-код параллельного ассемблера ( -j 4 ) на программе из многих частей сравнивается с последовательным.
+# Программа после оптимизатора ( -O1, -O2 ) на каждом движке должна выводить то же, что и без него.
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh и ./src/Processor/mk-processor.sh
+
+ENGINES="threaded tos jit"
+INPUTS="0_0_0 1_-3_2 1_2_1 5_6_0 7_0_0 12_1_1 100000_0_0"
+CC=${CC:-cc}
+WORK_DIR=$( mktemp -d )
+FAILED=0
+
+command -v "$CC" > /dev/null 2>&1 || { echo "No C compiler \"$CC\", C backend is not checked"; CC=""; }
+
+for program in ./tests/*.txt; do
+    name=$( basename "$program" .txt )
+    ./assembler -i "$program" -o "$WORK_DIR/$name.bc"           > /dev/null 2>&1 &&
+    ./assembler -i "$program" -o "$WORK_DIR/$name.code" -f text > /dev/null 2>&1 &&
+    ./assembler -i "$program" -o "$WORK_DIR/$name.O1.bc" -O1    > /dev/null 2>&1 &&
+    ./assembler -i "$program" -o "$WORK_DIR/$name.O2.bc" -O2    > /dev/null 2>&1 || { echo "FAIL $name: assembler"; FAILED=1; continue; }
+
+    native=""
+    if [ -n "$CC" ]; then
+        if ./assembler -i "$program" -o "$WORK_DIR/$name.c" -f c > /dev/null 2>&1 &&
+           "$CC" -O2 "$WORK_DIR/$name.c" -o "$WORK_DIR/$name.native" -lm; then
+            native="$WORK_DIR/$name.native"
+        else
+            echo "FAIL $name: C backend"
+            FAILED=1
+        fi
+    fi
+
+    : > "$WORK_DIR/$name.manifest"
+    for input in $INPUTS; do
+        echo "$input" | tr '_' ' ' > "$WORK_DIR/$name.$input.in"
+        echo "$WORK_DIR/$name.$input.in" >> "$WORK_DIR/$name.manifest"
+    done
+
+    for engine in switch $ENGINES; do
+        if ! ./processor -i "$WORK_DIR/$name.bc" -e "$engine" -b "$WORK_DIR/$name.manifest" -j 4 > /dev/null 2>&1; then
+            echo "FAIL $name (batch $engine)"
+            FAILED=1
+            continue
+        fi
+
+        for input in $INPUTS; do
+            expected=$( ./processor -i "$WORK_DIR/$name.bc" < "$WORK_DIR/$name.$input.in" 2>&1 )
+            actual=$( cat "$WORK_DIR/$name.$input.in.out" )
+
+            if [ "$actual" != "$expected" ]; then
+                echo "FAIL $name (batch $engine, input \"$input\")"
+                FAILED=1
+            fi
+        done
+    done
+
+    for input in $INPUTS; do
+        input=$( echo "$input" | tr '_' ' ' )
+
+        # Пустую строку печатает загрузчик текстового формата, а не сама программа
+        expected=$( echo "$input" | ./processor -i "$WORK_DIR/$name.code" -e switch 2>&1 | grep -v '^$' )
+
+        for flags in "" "-F" "-V" "-C"; do
+            for engine in switch $ENGINES; do
+                actual=$( echo "$input" | ./processor -i "$WORK_DIR/$name.bc" -e "$engine" $flags 2>&1 | grep -v '^$' )
+
+                if [ "$actual" != "$expected" ]; then
+                    echo "FAIL $name ($engine $flags, input \"$input\")"
+                    FAILED=1
+                fi
+            done
+        done
+
+        expected=$( echo "$input" | ./processor -i "$WORK_DIR/$name.bc" 2>&1 )
+        for level in O1 O2; do
+            for engine in switch $ENGINES; do
+                actual=$( echo "$input" | ./processor -i "$WORK_DIR/$name.$level.bc" -e "$engine" 2>&1 )
+
+                if [ "$actual" != "$expected" ]; then
+                    echo "FAIL $name (-$level, $engine, input \"$input\")"
+                    FAILED=1
+                fi
+            done
+        done
+
+        if [ -n "$native" ]; then
+            actual=$( echo "$input" | "$native" 2>&1 )
+
+            if [ "$actual" != "$expected" ]; then
+                echo "FAIL $name (C backend, input \"$input\")"
+                FAILED=1
+            fi
+        fi
+    done
+done
+
+# Метки объявлены и до, и после ссылок на них, так что ссылки пересекают границы частей
+awk 'BEGIN {
+    for ( i = 0; i < 4000; i++ ) {
+        print ":part_" i
+        print "    PUSH " i
+        print "    POPR RAX"
+        print "    JB :part_" ( ( i * 7919 ) % 4000 )
+        print "    CALL :part_" ( 3999 - i )
+    }
+    print "HLT"
+}' > "$WORK_DIR/parallel.txt"
+
+if ! ./assembler -i "$WORK_DIR/parallel.txt" -o "$WORK_DIR/parallel.1.bc"      > /dev/null 2>&1 ||
+   ! ./assembler -i "$WORK_DIR/parallel.txt" -o "$WORK_DIR/parallel.4.bc" -j 4 > /dev/null 2>&1 ||
+   ! cmp -s "$WORK_DIR/parallel.1.bc" "$WORK_DIR/parallel.4.bc"; then
+    echo "FAIL parallel assembler ( -j 4 )"
+    FAILED=1
+fi
+
+rm -r "$WORK_DIR"
+
+[ $FAILED -eq 0 ] && echo "All engines agree"
+exit $FAILED
@@ -0,0 +1,60 @@
+#!/bin/sh
+
+# Образ RAM ( -m, -w ): запуск с -w sync заполняет новый образ таблицей квадратов и сохраняет ее на диск,
+# следующий запуск читает таблицу без заполнения. Запись в режиме private не меняет файл, в режиме shared - меняет.
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh и ./src/Processor/mk-processor.sh
+
+WORK_DIR=$( mktemp -d )
+IMAGE="$WORK_DIR/squares.img"
+FAILED=0
+
+cat > "$WORK_DIR/build.txt" << EOF
+PUSH 0
+POPR RCX
+:loop
+PUSHR RCX
+PUSH 1000
+JAE :done
+PUSHR RCX
+PUSHR RCX
+MUL
+POPM [RCX]
+PUSHR RCX
+PUSH 1
+ADD
+POPR RCX
+JMP :loop
+:done
+HLT
+EOF
+
+cat > "$WORK_DIR/use.txt" << EOF
+PUSHM 999
+OUT
+PUSH 5
+POPM 999
+HLT
+EOF
+
+./assembler -i "$WORK_DIR/build.txt" -o "$WORK_DIR/build.bc" > /dev/null 2>&1
+./assembler -i "$WORK_DIR/use.txt"   -o "$WORK_DIR/use.bc"   > /dev/null 2>&1
+
+expect() {
+    result=$( ./processor -i "$WORK_DIR/use.bc" -m "$IMAGE" "$@" 2>&1 | grep -o "Output: [0-9]*" )
+    [ "$result" = "Output: $EXPECTED" ] || { echo "FAIL: $* - expected $EXPECTED, got \"$result\""; FAILED=1; }
+}
+
+for engine in switch threaded tos jit; do
+    rm -f "$IMAGE"
+    ./processor -i "$WORK_DIR/build.bc" -m "$IMAGE" -w sync -M 4096 -e $engine > /dev/null 2>&1
+
+    EXPECTED=998001 expect -e $engine
+    EXPECTED=998001 expect -e $engine -w private
+    EXPECTED=998001 expect -e $engine -w shared
+    EXPECTED=5      expect -e $engine
+done
+
+rm -r "$WORK_DIR"
+
+[ $FAILED -eq 0 ] && echo "RAM image works"
+exit $FAILED
@@ -0,0 +1,98 @@
+#!/bin/sh
+
+# Верификатор байт-кода: программы с опустошением стека ( и тогда, когда глубины расходятся на другом пути ),
+# RET без CALL и прямым адресом вне RAM отвергаются при загрузке с точным адресом, регистр вне REGS_NUMBER -
+# уже ассемблером.
+# Проверенная программа исполняется без проверок стека: емкость сразу равна наибольшей глубине,
+# и стек не расширяется ни разу; с -C расширяется, как раньше. Стек, растущий в цикле, не проверить -
+# такая программа исполняется с проверками.
+# Запуск из корня репозитория после ./src/Assembler/mk-assembler.sh и ./src/Processor/mk-processor.sh
+
+WORK_DIR=$( mktemp -d )
+FAILED=0
+
+# Ассемблирует программу из stdin в $WORK_DIR/$1.bc
+assemble() {
+    cat > "$WORK_DIR/$1.txt"
+    ./assembler -i "$WORK_DIR/$1.txt" -o "$WORK_DIR/$1.bc" > /dev/null 2>&1 || { echo "FAIL $1: assembler"; FAILED=1; }
+}
+
+# Загрузка отвергнута, и сообщение содержит $EXPECTED
+rejected() {
+    name=$1
+    shift
+    result=$( ./processor -i "$WORK_DIR/$name.bc" "$@" 2>&1 )
+    status=$?
+    [ $status -ne 0 ] && echo "$result" | grep -qF "$EXPECTED" ||
+        { echo "FAIL $name: expected \"$EXPECTED\", got \"$result\""; FAILED=1; }
+}
+
+printf "PUSH 1\nADD\nOUT\nHLT\n" | assemble underflow
+EXPECTED="Stack underflow: ADD at address 2 needs 2 values, stack has 1" rejected underflow
+
+# Глубины расходятся в :loop, но путь в :bad проходит мимо цикла, и глубина POP на нем одна
+printf "PUSH 0\nPUSH 1\nJB :bad\n:loop\nPUSH 1\nPUSH 1\nPUSH 2\nJB :loop\nHLT\n:bad\nPOP\nOUT\nHLT\n" | assemble branch
+EXPECTED="Stack underflow: POP at address 15 needs 1 values, stack has 0" rejected branch
+
+printf "PUSH 1\nOUT\n:f\nRET\nHLT\n" | assemble ret
+EXPECTED="RET without CALL at address 3" rejected ret
+
+printf "PUSHM 5000\nOUT\nHLT\n" | assemble address
+EXPECTED="RAM address 5000 of PUSHMA at address 0 is out of RAM ( 4096 words )" rejected address -M 4096
+
+printf "PUSHR RZX\nOUT\nHLT\n" > "$WORK_DIR/register.txt"
+result=$( ./assembler -i "$WORK_DIR/register.txt" -o "$WORK_DIR/register.bc" 2>&1 )
+echo "$result" | grep -qF "Register RZX is out of range ( RAX..RIX )" ||
+    { echo "FAIL register: got \"$result\""; FAILED=1; }
+
+# 100 значений на стеке, затем их сумма: 1 + 2 + ... + 100
+awk 'BEGIN {
+    for ( i = 1; i <= 100; i++ ) print "PUSH " i
+    for ( i = 1; i < 100; i++ )  print "ADD"
+    print "OUT"
+    print "HLT"
+}' | assemble deep
+
+# Стек растет в цикле ( глубины на входе в :loop разные ), затем снимается до 0
+assemble loop << EOF
+PUSH 0
+PUSH 3
+POPR RCX
+:loop
+PUSHR RCX
+PUSHR RCX
+PUSH 1
+SUB
+POPR RCX
+PUSHR RCX
+PUSH 0
+JA :loop
+ADD
+ADD
+OUT
+HLT
+EOF
+
+for engine in switch threaded tos jit; do
+    stats=$( ./processor -i "$WORK_DIR/deep.bc" -e $engine -s 2>&1 )
+    echo "$stats" | grep -q "Output: 5050" &&
+    echo "$stats" | grep -q "verifier = verified; max stack depth = 100" ||
+        { echo "FAIL deep ($engine): $stats"; FAILED=1; }
+
+    # Единственное перевыделение - емкость 100 при загрузке
+    echo "$stats" | grep -q "Stats: stack capacity = 100 (initial 8); reallocs = 1;" ||
+        { echo "FAIL deep ($engine): stack was grown during execution"; FAILED=1; }
+
+    stats=$( ./processor -i "$WORK_DIR/deep.bc" -e $engine -s -C 2>&1 )
+    echo "$stats" | grep -q "Output: 5050" && echo "$stats" | grep -q "stack checks = on" ||
+        { echo "FAIL deep ($engine -C): $stats"; FAILED=1; }
+
+    stats=$( ./processor -i "$WORK_DIR/loop.bc" -e $engine -s 2>&1 )
+    echo "$stats" | grep -q "Output: 6" && echo "$stats" | grep -q "verifier = not verified" ||
+        { echo "FAIL loop ($engine): $stats"; FAILED=1; }
+done
+
+rm -r "$WORK_DIR"
+
+[ $FAILED -eq 0 ] && echo "Verifier works"
+exit $FAILED